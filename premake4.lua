@@ -1,11 +1,16 @@
-solution 'ccam_atis_sepia'
-    configurations {'release', 'debug'}
-    location 'build'
-    project 'ccam_atis_sepia'
+newoption {
+    trigger = 'avx2',
+    description = 'Compile the AVX2 decoder (the default SSE2 decoder runs on any x86-64 CPU)'
+}
+
+-- console_project declares a console application built from the given files
+-- projects that do not use usb-1.0 (the shared memory ring and its reader) only link with the POSIX libraries
+local function console_project(name, project_files, use_usb)
+    project(name)
         kind 'ConsoleApp'
         language 'C++'
         location 'build'
-        files {'source/*.hpp', 'test/*.cpp'}
+        files(project_files)
         defines {'SEPIA_COMPILER_WORKING_DIRECTORY="' .. project().location .. '"'}
         configuration 'release'
             targetdir 'build/release'
@@ -15,17 +20,46 @@ solution 'ccam_atis_sepia'
             targetdir 'build/debug'
             defines {'DEBUG'}
             flags {'Symbols'}
-        configuration 'linux'
-            links {'pthread', 'usb-1.0'}
-            buildoptions {'-std=c++11'}
-            linkoptions {'-std=c++11'}
-        configuration 'macosx'
-            includedirs {'/usr/local/include'}
-            libdirs {'/usr/local/lib'}
-            links {'usb-1.0'}
+        configuration 'linux or macosx'
             buildoptions {'-std=c++11'}
             linkoptions {'-std=c++11'}
+        if use_usb then
+            configuration 'linux'
+                links {'pthread', 'usb-1.0', 'rt'}
+            configuration 'macosx'
+                includedirs {'/usr/local/include'}
+                libdirs {'/usr/local/lib'}
+                links {'usb-1.0'}
+            configuration 'windows'
+                files {'.clang-format'}
+                includedirs {'C:\\Include'}
+                links {'C:\\Windows\\SysWOW64\\libusb-1.0'}
+        else
+            configuration 'linux'
+                links {'pthread', 'rt'}
+        end
+        configuration {}
+end
+
+solution 'ccam_atis_sepia'
+    configurations {'release', 'debug'}
+    location 'build'
+    if _OPTIONS['avx2'] then
+        configuration 'linux or macosx'
+            buildoptions {'-mavx2'}
         configuration 'windows'
-            files {'.clang-format'}
-            includedirs {'C:\\Include'}
-            links {'C:\\Windows\\SysWOW64\\libusb-1.0'}
+            buildoptions {'/arch:AVX2'}
+        configuration {}
+    end
+    console_project('ccam_atis_sepia', {'source/*.hpp', 'test/ccam_atis_sepia.cpp'}, true)
+    console_project('ccam_atis_sepia_decode', {'source/*.hpp', 'test/decode.cpp'}, true)
+    console_project(
+        'ccam_atis_sepia_overflow', {'source/*.hpp', 'test/detached_camera.hpp', 'test/overflow.cpp'}, true)
+    console_project(
+        'ccam_atis_sepia_benchmark', {'source/*.hpp', 'test/detached_camera.hpp', 'test/benchmark.cpp'}, true)
+    -- the shared memory ring relies on POSIX shared memory, and does not need usb-1.0
+    if os.get() ~= 'windows' then
+        console_project('ccam_atis_sepia_ring', {'source/ccam_atis_sepia_ring.hpp', 'test/ring.cpp'}, false)
+        console_project(
+            'ccam_atis_sepia_reader', {'source/ccam_atis_sepia_ring.hpp', 'test/shared_memory_reader.cpp'}, false)
+    end
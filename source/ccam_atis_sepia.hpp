@@ -1,418 +1,4207 @@
 #pragma once
 
 #include "../third_party/sepia/source/sepia.hpp"
+#include "ccam_atis_sepia_ring.hpp"
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <libusb-1.0/libusb.h>
+#include <future>
+#include <limits>
+#include <mutex>
+#if defined(_WIN32)
+#include <fstream>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#if defined(__AVX2__)
+#define CCAM_ATIS_SEPIA_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CCAM_ATIS_SEPIA_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#define CCAM_ATIS_SEPIA_DEPRECATED(message) __declspec(deprecated(message))
+#else
+#define CCAM_ATIS_SEPIA_DEPRECATED(message) __attribute__((deprecated(message)))
+#endif
 
 /// ccam_atis_sepia specialises sepia for the CCam ATIS.
 /// In order to use this header, an application must link to the dynamic library usb-1.0.
 namespace ccam_atis_sepia {
 
+    /// region_of_interest is a rectangle of pixels.
+    struct region_of_interest {
+        /// x is the abscissa of the rectangle's left column.
+        uint16_t x;
+
+        /// y is the ordinate of the rectangle's bottom row.
+        uint16_t y;
+
+        /// width is the number of columns.
+        uint16_t width;
+
+        /// height is the number of rows.
+        uint16_t height;
+    };
+
+    /// pixel_mask is a bit-packed mask with one bit per CCam ATIS pixel.
+    /// Events are kept if their pixel's bit is set.
+    class pixel_mask {
+        public:
+        pixel_mask(bool keep = true) {
+            _words.fill(keep ? 0xffffffff : 0);
+        }
+        pixel_mask(const std::vector<region_of_interest>& regions) : pixel_mask(false) {
+            for (const auto& region : regions) {
+                for (uint32_t y = region.y; y < static_cast<uint32_t>(region.y) + region.height && y < 240; ++y) {
+                    for (uint32_t x = region.x; x < static_cast<uint32_t>(region.x) + region.width && x < 304; ++x) {
+                        set(static_cast<uint16_t>(x), static_cast<uint16_t>(y), true);
+                    }
+                }
+            }
+        }
+        pixel_mask(const pixel_mask&) = default;
+        pixel_mask(pixel_mask&&) = default;
+        pixel_mask& operator=(const pixel_mask&) = default;
+        pixel_mask& operator=(pixel_mask&&) = default;
+        virtual ~pixel_mask() {}
+
+        /// set changes the bit of the given pixel, and throws if the pixel is outside the sensor.
+        void set(uint16_t x, uint16_t y, bool keep) {
+            if (x >= 304 || y >= 240) {
+                throw std::out_of_range("the pixel is outside the sensor");
+            }
+            const auto index = static_cast<uint32_t>(y) * 304 + x;
+            if (keep) {
+                _words[index >> 5] |= (1u << (index & 0x1f));
+            } else {
+                _words[index >> 5] &= ~(1u << (index & 0x1f));
+            }
+        }
+
+        /// test returns the bit of the given pixel, or false if the pixel is outside the sensor.
+        bool test(uint16_t x, uint16_t y) const {
+            if (x >= 304 || y >= 240) {
+                return false;
+            }
+            const auto index = static_cast<uint32_t>(y) * 304 + x;
+            return ((_words[index >> 5] >> (index & 0x1f)) & 1) == 1;
+        }
+
+        /// words returns the packed bits, pixel (x, y) being bit (y * 304 + x).
+        const uint32_t* words() const {
+            return _words.data();
+        }
+
+        protected:
+        std::array<uint32_t, (304 * 240 + 31) / 32> _words;
+    };
+
+    /// decode_state holds the decoder state carried from one buffer to the next.
+    struct decode_state {
+        decode_state() :
+            t_base(0),
+            t_offset(0),
+            overflow_counter(0),
+            overflow_words(0),
+            counter_discontinuities(0),
+            masked_events(0),
+            partial_word{{0, 0, 0, 0}},
+            partial_size(0) {}
+
+        /// t_base is added to the timestamps encoded by overflow words.
+        /// It grows by 2^35 microseconds (about 9.5 hours) whenever the 24-bit overflow counter wraps,
+        /// and keeps timestamps monotonic when the camera's clock is reset by a reconnection.
+        uint64_t t_base;
+
+        /// t_offset is the timestamp encoded by the last overflow word (plus t_base).
+        uint64_t t_offset;
+
+        /// overflow_counter is the counter encoded by the last overflow word.
+        uint32_t overflow_counter;
+
+        /// overflow_words is the number of overflow words decoded so far.
+        uint64_t overflow_words;
+
+        /// counter_discontinuities is the number of overflow words whose counter decreased without wrapping.
+        uint64_t counter_discontinuities;
+
+        /// masked_events is the number of events discarded by the pixel mask so far.
+        uint64_t masked_events;
+
+        /// partial_word holds the bytes of a word split across two buffers.
+        std::array<uint8_t, 4> partial_word;
+
+        /// partial_size is the number of bytes in partial_word.
+        uint8_t partial_size;
+    };
+
+    /// decode_word decodes the 4-byte word starting at bytes.
+    /// Overflow words update the state, other words are passed to handle_event unless the mask discards them.
+    /// A counter decrease larger than half the 24-bit range is a wrap, and moves t_base forward.
+    /// A smaller decrease cannot be a wrap (the counter would have skipped millions of overflows):
+    /// it is counted as a discontinuity, and t_base is left unchanged.
+    template <typename HandleEvent>
+    inline void
+    decode_word(const uint8_t* bytes, decode_state& state, const pixel_mask* mask, HandleEvent& handle_event) {
+        if (bytes[3] == 0x80) {
+            const auto overflow_counter = static_cast<uint32_t>(bytes[0])
+                                          | (static_cast<uint32_t>(bytes[1]) << 8)
+                                          | (static_cast<uint32_t>(bytes[2]) << 16);
+            if (overflow_counter < state.overflow_counter) {
+                if (state.overflow_counter - overflow_counter > 0x800000) {
+                    state.t_base += static_cast<uint64_t>(0x1000000) * 0x800;
+                } else {
+                    ++state.counter_discontinuities;
+                }
+            }
+            state.overflow_counter = overflow_counter;
+            state.t_offset = state.t_base + static_cast<uint64_t>(overflow_counter) * 0x800;
+            ++state.overflow_words;
+        } else {
+            sepia::atis_event event;
+            event.x = static_cast<uint16_t>((static_cast<uint16_t>(bytes[2] & 0x1) << 8) | bytes[1]);
+            event.y = static_cast<uint16_t>(239 - bytes[0]);
+            if (mask != nullptr && !mask->test(event.x, event.y)) {
+                ++state.masked_events;
+                return;
+            }
+            event.t = state.t_offset + ((static_cast<uint64_t>(bytes[3] & 0xf) << 7) | (bytes[2] >> 1));
+            event.polarity = ((bytes[3] & 0b10000) >> 4) == 1;
+            event.is_threshold_crossing = ((bytes[3] & 0b100000) >> 5) == 1;
+            handle_event(event);
+        }
+    }
+
+    /// decode_lanes passes pre-computed events to handle_event.
+    /// Each xys entry packs x (low 16 bits) and y (high 16 bits).
+    /// Each ts entry packs the timestamp's low 11 bits, the polarity (bit 16) and is_threshold_crossing (bit 17).
+    template <std::size_t count, typename HandleEvent>
+    inline void decode_lanes(const uint32_t* xys, const uint32_t* ts, decode_state& state, HandleEvent& handle_event) {
+        sepia::atis_event event;
+        for (std::size_t index = 0; index < count; ++index) {
+            event.x = static_cast<uint16_t>(xys[index] & 0xffff);
+            event.y = static_cast<uint16_t>(xys[index] >> 16);
+            event.t = state.t_offset + (ts[index] & 0xffff);
+            event.polarity = ((ts[index] >> 16) & 1) == 1;
+            event.is_threshold_crossing = ((ts[index] >> 17) & 1) == 1;
+            handle_event(event);
+        }
+    }
+
+    /// compact_lanes appends the pre-computed events whose bit is set in keep to events, and updates size.
+    /// The lanes are packed as in decode_lanes, and the other lanes are counted as masked events.
+    /// Every lane is written and the output only advances past kept lanes, since mask bits are unpredictable.
+    template <std::size_t count>
+    inline void compact_lanes(
+        const uint32_t* xys,
+        const uint32_t* ts,
+        uint32_t keep,
+        decode_state& state,
+        sepia::atis_event* events,
+        std::size_t& size) {
+        const auto previous_size = size;
+        for (std::size_t index = 0; index < count; ++index) {
+            auto& event = events[size];
+            event.x = static_cast<uint16_t>(xys[index] & 0xffff);
+            event.y = static_cast<uint16_t>(xys[index] >> 16);
+            event.t = state.t_offset + (ts[index] & 0xffff);
+            event.polarity = ((ts[index] >> 16) & 1) == 1;
+            event.is_threshold_crossing = ((ts[index] >> 17) & 1) == 1;
+            size += (keep >> index) & 1;
+        }
+        state.masked_events += count - (size - previous_size);
+    }
+
+    /// decode converts raw CCam ATIS bytes to events, and calls handle_event for each one.
+    /// Trailing bytes that do not form a complete word are kept in state and completed by the next buffer,
+    /// so that buffers whose size is not a multiple of 4 do not shift the word boundaries.
+    /// If mask is not null, events from pixels whose bit is not set are discarded.
+    /// Blocks without overflow words are decoded with SSE2 or AVX2 when available.
+    /// Masked blocks are compacted into a local buffer, which is passed to handle_event in runs of events.
+    template <typename HandleEvent>
+    inline void decode(
+        const uint8_t* bytes,
+        std::size_t size,
+        decode_state& state,
+        const pixel_mask* mask,
+        HandleEvent&& handle_event) {
+        if (state.partial_size > 0) {
+            for (; state.partial_size < 4 && size > 0; ++bytes, --size) {
+                state.partial_word[state.partial_size] = *bytes;
+                ++state.partial_size;
+            }
+            if (state.partial_size < 4) {
+                return;
+            }
+            state.partial_size = 0;
+            decode_word(state.partial_word.data(), state, mask, handle_event);
+        }
+        const auto end = bytes + (size - size % 4);
+        std::copy(end, end + size % 4, state.partial_word.begin());
+        state.partial_size = static_cast<uint8_t>(size % 4);
+#if defined(CCAM_ATIS_SEPIA_AVX2)
+        {
+            alignas(32) std::array<uint32_t, 8> xys;
+            alignas(32) std::array<uint32_t, 8> ts;
+            std::array<sepia::atis_event, 64> kept_events;
+            std::size_t kept_size = 0;
+            auto flush = [&]() {
+                for (std::size_t index = 0; index < kept_size; ++index) {
+                    handle_event(kept_events[index]);
+                }
+                kept_size = 0;
+            };
+            const auto high_byte_mask = _mm256_set1_epi32(static_cast<int32_t>(0xff000000));
+            const auto overflow_marker = _mm256_set1_epi32(static_cast<int32_t>(0x80000000));
+            const auto x_mask = _mm256_set1_epi32(0x1ff);
+            const auto low_byte_mask = _mm256_set1_epi32(0xff);
+            const auto y_maximum = _mm256_set1_epi32(239);
+            const auto t_mask = _mm256_set1_epi32(0x7ff);
+            const auto flags_mask = _mm256_set1_epi32(0x30000);
+            const auto width = _mm256_set1_epi32(304);
+            const auto bit_mask = _mm256_set1_epi32(0x1f);
+            const auto one = _mm256_set1_epi32(1);
+            for (; end - bytes >= 32; bytes += 32) {
+                const auto words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes));
+                if (_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi32(_mm256_and_si256(words, high_byte_mask), overflow_marker))
+                    != 0) {
+                    flush();
+                    for (auto word = bytes; word != bytes + 32; word += 4) {
+                        decode_word(word, state, mask, handle_event);
+                    }
+                    continue;
+                }
+                const auto xs = _mm256_and_si256(_mm256_srli_epi32(words, 8), x_mask);
+                const auto ys = _mm256_sub_epi32(y_maximum, _mm256_and_si256(words, low_byte_mask));
+                _mm256_store_si256(
+                    reinterpret_cast<__m256i*>(xys.data()), _mm256_or_si256(xs, _mm256_slli_epi32(ys, 16)));
+                _mm256_store_si256(
+                    reinterpret_cast<__m256i*>(ts.data()),
+                    _mm256_or_si256(
+                        _mm256_and_si256(_mm256_srli_epi32(words, 17), t_mask),
+                        _mm256_and_si256(_mm256_srli_epi32(words, 12), flags_mask)));
+                if (mask == nullptr) {
+                    decode_lanes<8>(xys.data(), ts.data(), state, handle_event);
+                } else {
+                    // lanes outside the sensor are not gathered, and their bit is zero
+                    const auto inside = _mm256_andnot_si256(
+                        _mm256_cmpgt_epi32(_mm256_setzero_si256(), ys), _mm256_cmpgt_epi32(width, xs));
+                    const auto indices = _mm256_add_epi32(_mm256_mullo_epi32(ys, width), xs);
+                    const auto gathered = _mm256_mask_i32gather_epi32(
+                        _mm256_setzero_si256(),
+                        reinterpret_cast<const int*>(mask->words()),
+                        _mm256_srli_epi32(indices, 5),
+                        inside,
+                        4);
+                    const auto keep = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                        _mm256_and_si256(_mm256_srlv_epi32(gathered, _mm256_and_si256(indices, bit_mask)), one),
+                        one))));
+                    compact_lanes<8>(xys.data(), ts.data(), keep, state, kept_events.data(), kept_size);
+                    if (kept_size > kept_events.size() - 8) {
+                        flush();
+                    }
+                }
+            }
+            flush();
+        }
+#elif defined(CCAM_ATIS_SEPIA_SSE2)
+        {
+            alignas(16) std::array<uint32_t, 4> xys;
+            alignas(16) std::array<uint32_t, 4> ts;
+            alignas(16) std::array<uint32_t, 4> indices;
+            alignas(16) std::array<uint32_t, 4> inside;
+            std::array<sepia::atis_event, 64> kept_events;
+            std::size_t kept_size = 0;
+            auto flush = [&]() {
+                for (std::size_t index = 0; index < kept_size; ++index) {
+                    handle_event(kept_events[index]);
+                }
+                kept_size = 0;
+            };
+            const auto high_byte_mask = _mm_set1_epi32(static_cast<int32_t>(0xff000000));
+            const auto overflow_marker = _mm_set1_epi32(static_cast<int32_t>(0x80000000));
+            const auto x_mask = _mm_set1_epi32(0x1ff);
+            const auto low_byte_mask = _mm_set1_epi32(0xff);
+            const auto y_maximum = _mm_set1_epi32(239);
+            const auto t_mask = _mm_set1_epi32(0x7ff);
+            const auto flags_mask = _mm_set1_epi32(0x30000);
+            const auto width = _mm_set1_epi32(304);
+            const auto one = _mm_set1_epi32(1);
+            for (; end - bytes >= 16; bytes += 16) {
+                const auto words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(words, high_byte_mask), overflow_marker)) != 0) {
+                    flush();
+                    for (auto word = bytes; word != bytes + 16; word += 4) {
+                        decode_word(word, state, mask, handle_event);
+                    }
+                    continue;
+                }
+                const auto xs = _mm_and_si128(_mm_srli_epi32(words, 8), x_mask);
+                const auto ys = _mm_sub_epi32(y_maximum, _mm_and_si128(words, low_byte_mask));
+                _mm_store_si128(reinterpret_cast<__m128i*>(xys.data()), _mm_or_si128(xs, _mm_slli_epi32(ys, 16)));
+                _mm_store_si128(
+                    reinterpret_cast<__m128i*>(ts.data()),
+                    _mm_or_si128(
+                        _mm_and_si128(_mm_srli_epi32(words, 17), t_mask),
+                        _mm_and_si128(_mm_srli_epi32(words, 12), flags_mask)));
+                if (mask == nullptr) {
+                    decode_lanes<4>(xys.data(), ts.data(), state, handle_event);
+                } else {
+                    // lanes outside the sensor read the first mask word, and their inside bit clears their keep bit
+                    const auto inside_lanes = _mm_andnot_si128(
+                        _mm_cmpgt_epi32(_mm_setzero_si128(), ys), _mm_cmplt_epi32(xs, width));
+                    _mm_store_si128(reinterpret_cast<__m128i*>(inside.data()), _mm_and_si128(inside_lanes, one));
+                    _mm_store_si128(
+                        reinterpret_cast<__m128i*>(indices.data()),
+                        _mm_and_si128(
+                            inside_lanes,
+                            _mm_add_epi32(
+                                _mm_add_epi32(_mm_slli_epi32(ys, 8), _mm_slli_epi32(ys, 5)),
+                                _mm_add_epi32(_mm_slli_epi32(ys, 4), xs))));
+                    const auto mask_words = mask->words();
+                    uint32_t keep = 0;
+                    for (uint32_t index = 0; index < 4; ++index) {
+                        keep |= (((mask_words[indices[index] >> 5] >> (indices[index] & 0x1f)) & inside[index])
+                                 << index);
+                    }
+                    compact_lanes<4>(xys.data(), ts.data(), keep, state, kept_events.data(), kept_size);
+                    if (kept_size > kept_events.size() - 4) {
+                        flush();
+                    }
+                }
+            }
+            flush();
+        }
+#endif
+        for (; bytes != end; bytes += 4) {
+            decode_word(bytes, state, mask, handle_event);
+        }
+    }
+
+    /// decode converts raw CCam ATIS bytes to events without filtering.
+    template <typename HandleEvent>
+    inline void decode(const uint8_t* bytes, std::size_t size, decode_state& state, HandleEvent&& handle_event) {
+        decode(bytes, size, state, nullptr, std::forward<HandleEvent>(handle_event));
+    }
+
+    /// host_clock_fit maps device timestamps to the host's monotonic clock with a linear model.
+    /// It is a plain value, hence a batch of events can be converted with a single fit.
+    struct host_clock_fit {
+        host_clock_fit() : t_origin(0), host_origin(0), slope(1000.0), intercept(0.0), residual(0.0), samples(0) {}
+
+        /// t_origin is the device timestamp at the model's origin, in microseconds.
+        uint64_t t_origin;
+
+        /// host_origin is the host time at the model's origin, in nanoseconds since the steady clock's epoch.
+        int64_t host_origin;
+
+        /// slope is the number of host nanoseconds per device microsecond (nominally 1000).
+        double slope;
+
+        /// intercept is the model's host time at t_origin, relative to host_origin and in nanoseconds.
+        double intercept;
+
+        /// residual is the root mean square distance between the samples and the model, in nanoseconds.
+        /// Samples are taken when transfers complete, hence the model includes the mean transfer latency.
+        double residual;
+
+        /// samples is the number of samples used so far.
+        uint64_t samples;
+
+        /// host_time converts a device timestamp to host time.
+        std::chrono::steady_clock::time_point host_time(uint64_t t) const {
+            const auto delta =
+                t >= t_origin ? static_cast<double>(t - t_origin) : -static_cast<double>(t_origin - t);
+            return std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::nanoseconds(host_origin + static_cast<int64_t>(intercept + slope * delta))));
+        }
+    };
+
+    /// clock_correlator fits device timestamps against host time with exponentially weighted least squares.
+    /// The sums are expressed relative to the latest sample, which keeps them small and the fit accurate.
+    /// reset and add must be called from a single thread, fit can be called from any thread.
+    class clock_correlator {
+        public:
+        clock_correlator(double decay = 1.0 - 1.0 / 256) :
+            _decay(decay),
+            _sequence(0),
+            _t_origin(0),
+            _host_origin(0),
+            _slope(1000.0),
+            _intercept(0.0),
+            _residual(0.0),
+            _samples(0) {
+            reset();
+        }
+        clock_correlator(const clock_correlator&) = delete;
+        clock_correlator(clock_correlator&&) = delete;
+        clock_correlator& operator=(const clock_correlator&) = delete;
+        clock_correlator& operator=(clock_correlator&&) = delete;
+        virtual ~clock_correlator() {}
+
+        /// reset discards the samples, for instance after the device's clock was reset.
+        virtual void reset() {
+            _weight = 0;
+            _x = 0;
+            _y = 0;
+            _xx = 0;
+            _yy = 0;
+            _xy = 0;
+            _has_origin = false;
+            publish(host_clock_fit());
+        }
+
+        /// add updates the model with a device timestamp and the host time at which it was received.
+        virtual void add(uint64_t t, std::chrono::steady_clock::time_point host_time_point) {
+            const auto host = static_cast<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(host_time_point.time_since_epoch()).count());
+            host_clock_fit fit;
+            if (_has_origin) {
+                // move the origin to the new sample, then weigh the previous samples down
+                const auto dx =
+                    t >= _t_last ? static_cast<double>(t - _t_last) : -static_cast<double>(_t_last - t);
+                const auto dy = static_cast<double>(host - _host_last);
+                _xx += _weight * dx * dx - 2 * dx * _x;
+                _yy += _weight * dy * dy - 2 * dy * _y;
+                _xy += _weight * dx * dy - dx * _y - dy * _x;
+                _x -= _weight * dx;
+                _y -= _weight * dy;
+                _weight *= _decay;
+                _x *= _decay;
+                _y *= _decay;
+                _xx *= _decay;
+                _yy *= _decay;
+                _xy *= _decay;
+                fit.samples = _samples.load(std::memory_order_relaxed) + 1;
+            } else {
+                fit.samples = 1;
+            }
+            _weight += 1;
+            _t_last = t;
+            _host_last = host;
+            _has_origin = true;
+            fit.t_origin = t;
+            fit.host_origin = host;
+            const auto x_variance = _xx - _x * _x / _weight;
+            if (fit.samples > 1 && x_variance > 0) {
+                const auto covariance = _xy - _x * _y / _weight;
+                fit.slope = covariance / x_variance;
+                fit.intercept = (_y - fit.slope * _x) / _weight;
+                fit.residual =
+                    std::sqrt(std::max(0.0, (_yy - _y * _y / _weight - fit.slope * covariance) / _weight));
+            }
+            publish(fit);
+        }
+
+        /// fit returns the current model.
+        virtual host_clock_fit fit() const {
+            host_clock_fit result;
+            for (;;) {
+                const auto sequence = _sequence.load(std::memory_order_acquire);
+                if ((sequence & 1) == 0) {
+                    result.t_origin = _t_origin.load(std::memory_order_relaxed);
+                    result.host_origin = _host_origin.load(std::memory_order_relaxed);
+                    result.slope = _slope.load(std::memory_order_relaxed);
+                    result.intercept = _intercept.load(std::memory_order_relaxed);
+                    result.residual = _residual.load(std::memory_order_relaxed);
+                    result.samples = _samples.load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (_sequence.load(std::memory_order_relaxed) == sequence) {
+                        return result;
+                    }
+                }
+            }
+        }
+
+        protected:
+        /// publish makes a model visible to fit, with a sequence lock.
+        virtual void publish(const host_clock_fit& fit) {
+            const auto sequence = _sequence.load(std::memory_order_relaxed);
+            _sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            _t_origin.store(fit.t_origin, std::memory_order_relaxed);
+            _host_origin.store(fit.host_origin, std::memory_order_relaxed);
+            _slope.store(fit.slope, std::memory_order_relaxed);
+            _intercept.store(fit.intercept, std::memory_order_relaxed);
+            _residual.store(fit.residual, std::memory_order_relaxed);
+            _samples.store(fit.samples, std::memory_order_relaxed);
+            _sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        const double _decay;
+        double _weight;
+        double _x;
+        double _y;
+        double _xx;
+        double _yy;
+        double _xy;
+        bool _has_origin;
+        uint64_t _t_last;
+        int64_t _host_last;
+        std::atomic<uint64_t> _sequence;
+        std::atomic<uint64_t> _t_origin;
+        std::atomic<int64_t> _host_origin;
+        std::atomic<double> _slope;
+        std::atomic<double> _intercept;
+        std::atomic<double> _residual;
+        std::atomic<uint64_t> _samples;
+    };
+
+    /// acquisition_statistics is a snapshot of a camera's acquisition counters.
+    struct acquisition_statistics {
+        /// completed_transfers is the number of transfers (or replayed chunks) that completed normally.
+        uint64_t completed_transfers;
+
+        /// timed_out_transfers is the number of transfers that timed out (possibly with data).
+        /// Only blocking transfers time out, asynchronous transfers wait until they are full.
+        uint64_t timed_out_transfers;
+
+        /// dropped_transfers is the number of transfers whose data was lost.
+        uint64_t dropped_transfers;
+
+        /// cancelled_transfers is the number of asynchronous transfers cancelled by a stop, a failure or a
+        /// reconnection. Their partial data is discarded.
+        uint64_t cancelled_transfers;
+
+        /// short_transfers is the number of transfers whose length was not a multiple of 4.
+        /// Their trailing bytes are completed by the next transfer (see decode).
+        uint64_t short_transfers;
+
+        /// bytes is the number of raw bytes received.
+        uint64_t bytes;
+
+        /// events is the number of events decoded, including masked events.
+        uint64_t events;
+
+        /// masked_events is the number of events discarded by the pixel mask.
+        uint64_t masked_events;
+
+        /// overflow_words is the number of timestamp overflow words decoded.
+        uint64_t overflow_words;
+
+        /// counter_discontinuities is the number of overflow words whose counter decreased without wrapping.
+        /// Events following a discontinuity may have smaller timestamps than the events preceding it.
+        uint64_t counter_discontinuities;
+
+        /// fifo_high_water_mark is the largest FIFO occupancy observed after a transfer.
+        /// It is expressed in events, or in buffers for buffered cameras.
+        uint64_t fifo_high_water_mark;
+
+        /// dropped_raw_chunks is the number of transfers missing from the raw file.
+        uint64_t dropped_raw_chunks;
+
+        /// raw_direct_io is true if the raw file is written with O_DIRECT, bypassing the page cache.
+        /// It is false without raw file, or if the file system refused O_DIRECT and plain writes are used instead.
+        bool raw_direct_io;
+
+        /// shed_events is the number of events discarded by the overflow policy.
+        uint64_t shed_events;
+
+        /// decode_duration is the total time spent decoding and pushing events, in nanoseconds.
+        /// The mean decode time per transfer is decode_duration / (completed_transfers + timed_out_transfers).
+        uint64_t decode_duration;
+
+        /// maximum_decode_duration is the longest time spent on a single transfer, in nanoseconds.
+        uint64_t maximum_decode_duration;
+
+        /// reconnections is the number of times the camera was opened again after a disconnection.
+        uint64_t reconnections;
+
+        /// reconnect_duration is the total time spent reconnecting, in nanoseconds.
+        uint64_t reconnect_duration;
+
+        /// maximum_reconnect_duration is the longest time spent on a single reconnection, in nanoseconds.
+        uint64_t maximum_reconnect_duration;
+
+        /// lost_events is an estimate of the number of events lost during reconnections.
+        uint64_t lost_events;
+
+        /// event_rate_histogram counts transfers by event rate, measured since the previous transfer.
+        /// Bin k counts rates in [2^k, 2^(k + 1)[ events per second (bin 0 also counts lower rates).
+        std::array<uint64_t, 32> event_rate_histogram;
+    };
+
+    /// telemetry accumulates acquisition statistics.
+    /// The update functions must be called from a single thread, snapshot can be called from any thread.
+    class telemetry {
+        public:
+        telemetry() :
+            _completed_transfers(0),
+            _timed_out_transfers(0),
+            _dropped_transfers(0),
+            _cancelled_transfers(0),
+            _short_transfers(0),
+            _bytes(0),
+            _events(0),
+            _masked_events(0),
+            _overflow_words(0),
+            _counter_discontinuities(0),
+            _fifo_high_water_mark(0),
+            _shed_events(0),
+            _decode_duration(0),
+            _maximum_decode_duration(0),
+            _reconnections(0),
+            _reconnect_duration(0),
+            _maximum_reconnect_duration(0),
+            _lost_events(0),
+            _has_previous_time_point(false) {
+            for (auto& count : _event_rate_histogram) {
+                count.store(0, std::memory_order_relaxed);
+            }
+        }
+        telemetry(const telemetry&) = delete;
+        telemetry(telemetry&&) = delete;
+        telemetry& operator=(const telemetry&) = delete;
+        telemetry& operator=(telemetry&&) = delete;
+        virtual ~telemetry() {}
+
+        /// add_transfer updates the counters after a transfer has been decoded.
+        virtual void add_transfer(
+            bool timed_out,
+            std::size_t bytes,
+            std::size_t events,
+            std::size_t overflow_words,
+            std::size_t fifo_occupancy,
+            std::chrono::steady_clock::time_point decode_begin,
+            std::chrono::steady_clock::time_point decode_end) {
+            increment(timed_out ? _timed_out_transfers : _completed_transfers, 1);
+            increment(_bytes, bytes);
+            increment(_events, events);
+            increment(_overflow_words, overflow_words);
+            if (fifo_occupancy > _fifo_high_water_mark.load(std::memory_order_relaxed)) {
+                _fifo_high_water_mark.store(fifo_occupancy, std::memory_order_relaxed);
+            }
+            const auto decode_duration = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(decode_end - decode_begin).count());
+            increment(_decode_duration, decode_duration);
+            if (decode_duration > _maximum_decode_duration.load(std::memory_order_relaxed)) {
+                _maximum_decode_duration.store(decode_duration, std::memory_order_relaxed);
+            }
+            if (_has_previous_time_point) {
+                const auto elapsed = std::chrono::duration<double>(decode_end - _previous_time_point).count();
+                if (elapsed > 0) {
+                    const auto rate = static_cast<uint64_t>(static_cast<double>(events) / elapsed);
+                    std::size_t bin = 0;
+                    while (bin + 1 < _event_rate_histogram.size() && (rate >> (bin + 1)) > 0) {
+                        ++bin;
+                    }
+                    increment(_event_rate_histogram[bin], 1);
+                }
+            }
+            _previous_time_point = decode_end;
+            _has_previous_time_point = true;
+        }
+
+        /// add_dropped_transfer counts a transfer whose data was lost.
+        virtual void add_dropped_transfer() {
+            increment(_dropped_transfers, 1);
+        }
+
+        /// add_cancelled_transfer counts a cancelled asynchronous transfer.
+        virtual void add_cancelled_transfer() {
+            increment(_cancelled_transfers, 1);
+        }
+
+        /// add_short_transfer counts a transfer whose length was not a multiple of 4.
+        virtual void add_short_transfer() {
+            increment(_short_transfers, 1);
+        }
+
+        /// add_masked_events counts events discarded by the pixel mask.
+        virtual void add_masked_events(std::size_t events) {
+            increment(_masked_events, events);
+        }
+
+        /// add_counter_discontinuities counts overflow words whose counter decreased without wrapping.
+        virtual void add_counter_discontinuities(std::size_t discontinuities) {
+            increment(_counter_discontinuities, discontinuities);
+        }
+
+        /// add_shed_events counts events discarded by the overflow policy.
+        virtual void add_shed_events(std::size_t events) {
+            increment(_shed_events, events);
+        }
+
+        /// add_reconnection counts a reconnection, and the number of events estimated lost while it lasted.
+        virtual void add_reconnection(std::chrono::steady_clock::duration duration, std::size_t lost_events) {
+            const auto reconnect_duration =
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+            increment(_reconnections, 1);
+            increment(_reconnect_duration, reconnect_duration);
+            if (reconnect_duration > _maximum_reconnect_duration.load(std::memory_order_relaxed)) {
+                _maximum_reconnect_duration.store(reconnect_duration, std::memory_order_relaxed);
+            }
+            increment(_lost_events, lost_events);
+        }
+
+        /// snapshot returns the current counters.
+        /// Each counter is read atomically, but the counters are not read as a whole.
+        virtual acquisition_statistics snapshot() const {
+            acquisition_statistics statistics;
+            statistics.completed_transfers = _completed_transfers.load(std::memory_order_relaxed);
+            statistics.timed_out_transfers = _timed_out_transfers.load(std::memory_order_relaxed);
+            statistics.dropped_transfers = _dropped_transfers.load(std::memory_order_relaxed);
+            statistics.cancelled_transfers = _cancelled_transfers.load(std::memory_order_relaxed);
+            statistics.short_transfers = _short_transfers.load(std::memory_order_relaxed);
+            statistics.bytes = _bytes.load(std::memory_order_relaxed);
+            statistics.events = _events.load(std::memory_order_relaxed);
+            statistics.masked_events = _masked_events.load(std::memory_order_relaxed);
+            statistics.overflow_words = _overflow_words.load(std::memory_order_relaxed);
+            statistics.counter_discontinuities = _counter_discontinuities.load(std::memory_order_relaxed);
+            statistics.fifo_high_water_mark = _fifo_high_water_mark.load(std::memory_order_relaxed);
+            statistics.dropped_raw_chunks = 0;
+            statistics.raw_direct_io = false;
+            statistics.shed_events = _shed_events.load(std::memory_order_relaxed);
+            statistics.decode_duration = _decode_duration.load(std::memory_order_relaxed);
+            statistics.maximum_decode_duration = _maximum_decode_duration.load(std::memory_order_relaxed);
+            statistics.reconnections = _reconnections.load(std::memory_order_relaxed);
+            statistics.reconnect_duration = _reconnect_duration.load(std::memory_order_relaxed);
+            statistics.maximum_reconnect_duration = _maximum_reconnect_duration.load(std::memory_order_relaxed);
+            statistics.lost_events = _lost_events.load(std::memory_order_relaxed);
+            for (std::size_t bin = 0; bin < _event_rate_histogram.size(); ++bin) {
+                statistics.event_rate_histogram[bin] = _event_rate_histogram[bin].load(std::memory_order_relaxed);
+            }
+            return statistics;
+        }
+
+        protected:
+        /// increment adds a value to a counter without a read-modify-write instruction.
+        /// This is valid since each counter has a single writer.
+        static void increment(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> _completed_transfers;
+        std::atomic<uint64_t> _timed_out_transfers;
+        std::atomic<uint64_t> _dropped_transfers;
+        std::atomic<uint64_t> _cancelled_transfers;
+        std::atomic<uint64_t> _short_transfers;
+        std::atomic<uint64_t> _bytes;
+        std::atomic<uint64_t> _events;
+        std::atomic<uint64_t> _masked_events;
+        std::atomic<uint64_t> _overflow_words;
+        std::atomic<uint64_t> _counter_discontinuities;
+        std::atomic<uint64_t> _fifo_high_water_mark;
+        std::atomic<uint64_t> _shed_events;
+        std::atomic<uint64_t> _decode_duration;
+        std::atomic<uint64_t> _maximum_decode_duration;
+        std::atomic<uint64_t> _reconnections;
+        std::atomic<uint64_t> _reconnect_duration;
+        std::atomic<uint64_t> _maximum_reconnect_duration;
+        std::atomic<uint64_t> _lost_events;
+        std::array<std::atomic<uint64_t>, 32> _event_rate_histogram;
+        std::chrono::steady_clock::time_point _previous_time_point;
+        bool _has_previous_time_point;
+    };
+
+    /// raw_recorder writes raw CCam ATIS bytes to a file from a background thread.
+    /// The file starts with raw_recorder::signature(), followed by chunks.
+    /// Each chunk holds an 8-bytes host timestamp (nanoseconds since epoch), a 4-bytes length and the raw bytes.
+    /// Integers are little-endian.
+    class raw_recorder {
+        public:
+        /// signature returns the raw file signature.
+        static std::string signature() {
+            return std::string("CCam ATIS raw") + std::string({1, 0, 0});
+        }
+
+        /// chunk_header_size returns the number of bytes preceding each chunk's raw bytes.
+        static constexpr std::size_t chunk_header_size() {
+            return 12;
+        }
+
+        raw_recorder(const std::string& filename, std::size_t block_size, std::size_t block_count) :
+            _filename(filename),
+            _block_size(block_size),
+            _block_count(block_count),
+            _blocks(nullptr),
+            _head(0),
+            _tail(0),
+            _fill(0),
+            _writing(true),
+            _writer_failed(false),
+            _direct_io(false),
+            _dropped_chunks(0) {
+            if (_block_size == 0 || _block_size % alignment() != 0 || _block_count < 2) {
+                throw std::logic_error(
+                    "the block size must be a non-zero multiple of " + std::to_string(alignment())
+                    + " and the block count must be at least 2");
+            }
+#if defined(_WIN32)
+            _blocks = static_cast<uint8_t*>(_aligned_malloc(_block_size * _block_count, alignment()));
+#else
+            {
+                void* blocks;
+                if (posix_memalign(&blocks, alignment(), _block_size * _block_count) == 0) {
+                    _blocks = static_cast<uint8_t*>(blocks);
+                }
+            }
+#endif
+            if (_blocks == nullptr) {
+                throw std::bad_alloc();
+            }
+#if defined(__linux__)
+            // O_DIRECT bypasses the page cache, it is not supported by every file system
+            _descriptor = open(_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+            if (_descriptor < 0) {
+                _descriptor = open(_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            } else {
+                _direct_io = true;
+            }
+            if (_descriptor < 0) {
+                free_blocks();
+                throw sepia::unwritable_file(_filename);
+            }
+#else
+            _file = std::fopen(_filename.c_str(), "wb");
+            if (!_file) {
+                free_blocks();
+                throw sepia::unwritable_file(_filename);
+            }
+            std::setvbuf(_file, nullptr, _IONBF, 0);
+#endif
+            {
+                const auto file_signature = signature();
+                std::copy(file_signature.begin(), file_signature.end(), _blocks);
+                _fill = file_signature.size();
+            }
+            _writer_loop = std::thread([this]() -> void {
+                try {
+                    for (;;) {
+                        const auto current_tail = _tail.load(std::memory_order_relaxed);
+                        if (current_tail == _head.load(std::memory_order_acquire)) {
+                            if (!_writing.load(std::memory_order_acquire)) {
+                                break;
+                            }
+                            // the producer locks the mutex before notifying, hence no completed block is missed
+                            std::unique_lock<std::mutex> lock(_mutex);
+                            _condition_variable.wait(lock, [&]() {
+                                return current_tail != _head.load(std::memory_order_acquire)
+                                       || !_writing.load(std::memory_order_acquire);
+                            });
+                        } else {
+                            write_to_file(_blocks + current_tail * _block_size, _block_size);
+                            _tail.store((current_tail + 1) % _block_count, std::memory_order_release);
+                        }
+                    }
+                } catch (...) {
+                    _writer_exception = std::current_exception();
+                    _writer_failed.store(true, std::memory_order_release);
+                }
+            });
+        }
+        raw_recorder(const raw_recorder&) = delete;
+        raw_recorder(raw_recorder&&) = delete;
+        raw_recorder& operator=(const raw_recorder&) = delete;
+        raw_recorder& operator=(raw_recorder&&) = delete;
+        virtual ~raw_recorder() {
+            _writing.store(false, std::memory_order_release);
+            notify_writer();
+            _writer_loop.join();
+            try {
+#if defined(__linux__)
+                // the last block is partial, hence it cannot be written with O_DIRECT
+                fcntl(_descriptor, F_SETFL, fcntl(_descriptor, F_GETFL) & ~O_DIRECT);
+#endif
+                if (!_writer_failed.load(std::memory_order_acquire)) {
+                    write_to_file(_blocks + _head.load(std::memory_order_relaxed) * _block_size, _fill);
+                }
+            } catch (...) {
+            }
+#if defined(__linux__)
+            close(_descriptor);
+#else
+            std::fclose(_file);
+#endif
+            free_blocks();
+        }
+
+        /// write adds a chunk to the file.
+        /// It must always be called from the same thread.
+        /// The chunk is dropped (and counted) if the writer thread has fallen behind.
+        virtual void write(const uint8_t* bytes, std::size_t size) {
+            if (_writer_failed.load(std::memory_order_acquire)) {
+                std::rethrow_exception(_writer_exception);
+            }
+            const auto current_head = _head.load(std::memory_order_relaxed);
+            const auto available_blocks =
+                (_tail.load(std::memory_order_acquire) + _block_count - current_head - 1) % _block_count;
+            if (chunk_header_size() + size > available_blocks * _block_size + (_block_size - _fill)) {
+                _dropped_chunks.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::array<uint8_t, chunk_header_size()> header;
+            {
+                const auto timestamp = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count());
+                for (std::size_t index = 0; index < 8; ++index) {
+                    header[index] = static_cast<uint8_t>((timestamp >> (8 * index)) & 0xff);
+                }
+                const auto length = static_cast<uint32_t>(size);
+                for (std::size_t index = 0; index < 4; ++index) {
+                    header[8 + index] = static_cast<uint8_t>((length >> (8 * index)) & 0xff);
+                }
+            }
+            append(header.data(), header.size());
+            append(bytes, size);
+        }
+
+        /// dropped_chunks returns the number of chunks discarded because the writer thread had fallen behind.
+        virtual std::size_t dropped_chunks() const {
+            return _dropped_chunks.load(std::memory_order_relaxed);
+        }
+
+        /// direct_io returns true if the file is written with O_DIRECT (Linux only).
+        /// It returns false if the file system refused O_DIRECT, in which case writes go through the page cache.
+        virtual bool direct_io() const {
+            return _direct_io;
+        }
+
+        protected:
+        /// alignment returns the memory and file offset alignment required for unbuffered writes.
+        static constexpr std::size_t alignment() {
+            return 4096;
+        }
+
+        /// append copies bytes to the head block, and hands full blocks to the writer thread.
+        /// The caller must check that enough blocks are available.
+        virtual void append(const uint8_t* bytes, std::size_t size) {
+            while (size > 0) {
+                const auto current_head = _head.load(std::memory_order_relaxed);
+                const auto copied = std::min(size, _block_size - _fill);
+                std::memcpy(_blocks + current_head * _block_size + _fill, bytes, copied);
+                _fill += copied;
+                bytes += copied;
+                size -= copied;
+                if (_fill == _block_size) {
+                    _head.store((current_head + 1) % _block_count, std::memory_order_release);
+                    _fill = 0;
+                    notify_writer();
+                }
+            }
+        }
+
+        /// notify_writer wakes the writer thread up after a block completion or a stop request.
+        /// The mutex is locked so that the notification cannot fall between the writer's check and its wait.
+        virtual void notify_writer() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+            }
+            _condition_variable.notify_one();
+        }
+
+        /// write_to_file writes bytes to the file, and throws on error.
+        virtual void write_to_file(const uint8_t* bytes, std::size_t size) {
+            while (size > 0) {
+#if defined(__linux__)
+                const auto written = ::write(_descriptor, bytes, size);
+                if (written < 0) {
+                    throw sepia::unwritable_file(_filename);
+                }
+                const auto written_size = static_cast<std::size_t>(written);
+#else
+                const auto written_size = std::fwrite(bytes, 1, size, _file);
+                if (written_size == 0) {
+                    throw sepia::unwritable_file(_filename);
+                }
+#endif
+                bytes += written_size;
+                size -= written_size;
+            }
+        }
+
+        /// free_blocks releases the aligned memory.
+        virtual void free_blocks() {
+#if defined(_WIN32)
+            _aligned_free(_blocks);
+#else
+            std::free(_blocks);
+#endif
+        }
+
+        const std::string _filename;
+        const std::size_t _block_size;
+        const std::size_t _block_count;
+        uint8_t* _blocks;
+#if defined(__linux__)
+        int _descriptor;
+#else
+        std::FILE* _file;
+#endif
+        std::atomic<std::size_t> _head;
+        std::atomic<std::size_t> _tail;
+        std::size_t _fill;
+        std::atomic_bool _writing;
+        std::atomic_bool _writer_failed;
+        std::exception_ptr _writer_exception;
+        bool _direct_io;
+        std::atomic<std::size_t> _dropped_chunks;
+        std::mutex _mutex;
+        std::condition_variable _condition_variable;
+        std::thread _writer_loop;
+    };
+
+    /// memory_mapped_file provides read-only access to a file's bytes.
+    /// The file is mapped on POSIX systems and loaded in memory on Windows.
+    class memory_mapped_file {
+        public:
+        memory_mapped_file(const std::string& filename) : _begin(nullptr), _size(0) {
+#if defined(_WIN32)
+            std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+            if (!stream.good()) {
+                throw sepia::unreadable_file(filename);
+            }
+            _bytes.resize(static_cast<std::size_t>(stream.tellg()));
+            stream.seekg(0);
+            stream.read(reinterpret_cast<char*>(_bytes.data()), static_cast<std::streamsize>(_bytes.size()));
+            _begin = _bytes.data();
+            _size = _bytes.size();
+#else
+            const auto descriptor = open(filename.c_str(), O_RDONLY);
+            if (descriptor < 0) {
+                throw sepia::unreadable_file(filename);
+            }
+            struct stat status;
+            if (fstat(descriptor, &status) < 0) {
+                close(descriptor);
+                throw sepia::unreadable_file(filename);
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            if (_size > 0) {
+                const auto address = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (address == MAP_FAILED) {
+                    close(descriptor);
+                    throw sepia::unreadable_file(filename);
+                }
+                _begin = static_cast<const uint8_t*>(address);
+#if defined(POSIX_MADV_SEQUENTIAL)
+                posix_madvise(address, _size, POSIX_MADV_SEQUENTIAL);
+#endif
+            }
+            close(descriptor);
+#endif
+        }
+        memory_mapped_file(const memory_mapped_file&) = delete;
+        memory_mapped_file(memory_mapped_file&&) = delete;
+        memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+        memory_mapped_file& operator=(memory_mapped_file&&) = delete;
+        virtual ~memory_mapped_file() {
+#if !defined(_WIN32)
+            if (_begin != nullptr) {
+                munmap(const_cast<uint8_t*>(_begin), _size);
+            }
+#endif
+        }
+
+        /// data returns a pointer to the first byte.
+        const uint8_t* data() const {
+            return _begin;
+        }
+
+        /// size returns the number of bytes.
+        std::size_t size() const {
+            return _size;
+        }
+
+        protected:
+        const uint8_t* _begin;
+        std::size_t _size;
+#if defined(_WIN32)
+        std::vector<uint8_t> _bytes;
+#endif
+    };
+
+    /// device_location identifies a connected USB device.
+    /// The address changes whenever a device is plugged in again, hence a location cannot refer to another device.
+    struct device_location {
+        /// bus is the number of the bus the device is connected to.
+        uint8_t bus;
+
+        /// address is the device's address on the bus.
+        uint8_t address;
+
+        /// ports lists the port numbers from the root hub to the device.
+        std::array<uint8_t, 7> ports;
+
+        /// depth is the number of valid entries in ports.
+        std::size_t depth;
+    };
+
+    /// locate returns the location of a libusb device.
+    inline device_location locate(libusb_device* device) {
+        device_location location;
+        location.bus = libusb_get_bus_number(device);
+        location.address = libusb_get_device_address(device);
+        location.ports.fill(0);
+        const auto depth =
+            libusb_get_port_numbers(device, location.ports.data(), static_cast<int32_t>(location.ports.size()));
+        location.depth = depth < 0 ? 0 : static_cast<std::size_t>(depth);
+        return location;
+    }
+
+    /// operator== compares two device locations.
+    inline bool operator==(const device_location& first, const device_location& second) {
+        return first.bus == second.bus && first.address == second.address && first.depth == second.depth
+               && std::equal(first.ports.begin(), first.ports.begin() + first.depth, second.ports.begin());
+    }
+
+    /// device_registry caches the serials of the connected CCam ATIS cameras, keyed by location.
+    /// Serials are read once per device, without claiming the device's interface,
+    /// so that devices used by other processes are listed and not disturbed.
+    /// The registry is owned by its user: each camera owns one built on its context, and a camera group shares one
+    /// between its members.
+    /// If context is null, the registry creates its own context. In that case only, if watch_hotplug is true and
+    /// libusb supports hotplug, a thread handles the context's events and the cache is refreshed only when a camera
+    /// is plugged or unplugged. A shared context's events belong to its owner, hence they are never handled here.
+    /// Otherwise, the cache is refreshed whenever it is queried, which enumerates the bus but only opens new devices.
+    class device_registry {
+        public:
+        device_registry(libusb_context* context = nullptr, bool watch_hotplug = true) :
+            _context(context),
+            _owns_context(context == nullptr),
+            _hotplug(false),
+            _stale(true),
+            _running(true) {
+            if (!_owns_context) {
+                return;
+            }
+            const auto error = libusb_init(&_context);
+            if (error < 0) {
+                throw std::logic_error(
+                    std::string("initializing the USB context failed: ")
+                    + libusb_strerror(static_cast<libusb_error>(error)));
+            }
+            if (watch_hotplug && libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) != 0
+                && libusb_hotplug_register_callback(
+                       _context,
+                       static_cast<libusb_hotplug_event>(
+                           LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                       LIBUSB_HOTPLUG_NO_FLAGS,
+                       1204,
+                       244,
+                       LIBUSB_HOTPLUG_MATCH_ANY,
+                       &device_registry::handle_hotplug,
+                       this,
+                       &_hotplug_handle)
+                       == LIBUSB_SUCCESS) {
+                _hotplug = true;
+                _hotplug_loop = std::thread([this]() -> void {
+                    while (_running.load(std::memory_order_relaxed)) {
+                        timeval timeout;
+                        timeout.tv_sec = 0;
+                        timeout.tv_usec = 100000;
+                        libusb_handle_events_timeout(_context, &timeout);
+                    }
+                });
+            }
+        }
+        device_registry(const device_registry&) = delete;
+        device_registry(device_registry&&) = delete;
+        device_registry& operator=(const device_registry&) = delete;
+        device_registry& operator=(device_registry&&) = delete;
+        virtual ~device_registry() {
+            if (_hotplug) {
+                _running.store(false, std::memory_order_relaxed);
+                _hotplug_loop.join();
+                libusb_hotplug_deregister_callback(_context, _hotplug_handle);
+            }
+            if (_owns_context) {
+                libusb_exit(_context);
+            }
+        }
+
+        /// serials returns the serials of the connected cameras.
+        virtual std::vector<uint16_t> serials() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            refresh_if_stale();
+            std::vector<uint16_t> serials;
+            serials.reserve(_locations.size());
+            for (const auto& serial_and_location : _locations) {
+                serials.push_back(serial_and_location.first);
+            }
+            std::sort(serials.begin(), serials.end());
+            return serials;
+        }
+
+        /// find retrieves the location of the camera with the given serial.
+        /// It returns false if no such camera is connected.
+        virtual bool find(uint16_t serial, device_location& location) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            refresh_if_stale();
+            const auto serial_and_location = _locations.find(serial);
+            if (serial_and_location == _locations.end()) {
+                return false;
+            }
+            location = serial_and_location->second;
+            return true;
+        }
+
+        /// read_serial reads a camera's serial with a vendor control request, in the byte order of serials.
+        /// It only requires an open handle, the interface does not need to be claimed.
+        static bool read_serial(libusb_device_handle* handle, uint16_t& serial) {
+            auto data = std::array<uint8_t, 8>{};
+            if (libusb_control_transfer(handle, 192, 85, 32, 0, data.data(), static_cast<uint16_t>(data.size()), 0)
+                < 0) {
+                return false;
+            }
+            serial = static_cast<uint16_t>((static_cast<uint16_t>(data[6]) << 8) | static_cast<uint16_t>(data[7]));
+            return true;
+        }
+
+        /// swap_serial converts a serial between the byte order of serials (and camera::available_serials)
+        /// and the byte order of the serial passed to make_camera, which have always differed.
+        static uint16_t swap_serial(uint16_t serial) {
+            return static_cast<uint16_t>(static_cast<uint16_t>(serial << 8) | (serial >> 8));
+        }
+
+        protected:
+
+        /// handle_hotplug is called by libusb when a camera is plugged or unplugged.
+        /// Synchronous transfers are not allowed in hotplug callbacks, hence it only marks the cache as stale.
+        static int LIBUSB_CALL
+        handle_hotplug(libusb_context*, libusb_device*, libusb_hotplug_event, void* user_data) {
+            static_cast<device_registry*>(user_data)->_stale.store(true, std::memory_order_release);
+            return 0;
+        }
+
+        /// refresh_if_stale enumerates the cameras if the cache may be out of date.
+        /// Serials are only read for the devices whose location is not cached.
+        virtual void refresh_if_stale() {
+            if (_hotplug && !_stale.exchange(false, std::memory_order_acquire)) {
+                return;
+            }
+            std::unordered_map<uint16_t, device_location> locations;
+            libusb_device** devices;
+            const auto count = libusb_get_device_list(_context, &devices);
+            for (ssize_t index = 0; index < count; ++index) {
+                libusb_device_descriptor descriptor;
+                if (libusb_get_device_descriptor(devices[index], &descriptor) != 0 || descriptor.idVendor != 1204
+                    || descriptor.idProduct != 244) {
+                    continue;
+                }
+                const auto location = locate(devices[index]);
+                auto cached = false;
+                for (const auto& serial_and_location : _locations) {
+                    if (serial_and_location.second == location) {
+                        locations.insert(serial_and_location);
+                        cached = true;
+                        break;
+                    }
+                }
+                if (!cached) {
+                    libusb_device_handle* handle;
+                    if (libusb_open(devices[index], &handle) == 0) {
+                        uint16_t serial = 0;
+                        if (read_serial(handle, serial)) {
+                            locations[serial] = location;
+                        }
+                        libusb_close(handle);
+                    }
+                }
+            }
+            libusb_free_device_list(devices, 1);
+            _locations = std::move(locations);
+        }
+
+        libusb_context* _context;
+        const bool _owns_context;
+        bool _hotplug;
+        libusb_hotplug_callback_handle _hotplug_handle;
+        std::atomic_bool _stale;
+        std::atomic_bool _running;
+        std::mutex _mutex;
+        std::unordered_map<uint16_t, device_location> _locations;
+        std::thread _hotplug_loop;
+    };
+
     /// camera represents a CCam ATIS.
     class camera {
         public:
-        /// available_serials returns the connected CCam ATIS cameras' serials.
-        static std::vector<uint16_t> available_serials() {
-            std::vector<uint16_t> serials;
-            libusb_context* context;
-            check_usb_error(libusb_init(&context), "initializing the USB context");
-            libusb_device** devices;
-            const auto count = libusb_get_device_list(context, &devices);
-            for (ssize_t index = 0; index < count; ++index) {
-                libusb_device_descriptor descriptor;
-                if (libusb_get_device_descriptor(devices[index], &descriptor) == 0) {
-                    if (descriptor.idVendor == 1204 && descriptor.idProduct == 244) {
-                        libusb_device_handle* handle;
-                        check_usb_error(libusb_open(devices[index], &handle), "opening the device");
-                        if (libusb_claim_interface(handle, 0) == 0) {
-                            auto data = std::array<uint8_t, 8>{};
-                            check_usb_error(
-                                libusb_control_transfer(
-                                    handle, 192, 85, 32, 0, data.data(), static_cast<uint16_t>(data.size()), 0),
-                                "sending a control packet");
-                            libusb_release_interface(handle, 0);
-                            serials.push_back((static_cast<uint16_t>(data[6]) << 8) | static_cast<uint16_t>(data[7]));
+        /// available_serials returns the connected CCam ATIS cameras' serials.
+        /// The serials' bytes are swapped with respect to the serial passed to make_camera (see
+        /// device_registry::swap_serial), as in earlier versions.
+        /// Each call enumerates the bus with a temporary registry, see device_registry to keep the cache.
+        static std::vector<uint16_t> available_serials() {
+            return device_registry(nullptr, false).serials();
+        }
+
+        /// default_parameter returns the default parameter used by the CCam ATIS.
+        static std::unique_ptr<sepia::parameter> default_parameter() {
+            return sepia::make_unique<sepia::object_parameter>(
+                "change_detection",
+                sepia::make_unique<sepia::object_parameter>(
+                    "reset_switch_bulk_potential",
+                    sepia::make_unique<sepia::char_parameter>(207),
+                    "photoreceptor_feedback",
+                    sepia::make_unique<sepia::char_parameter>(243),
+                    "refractory_period",
+                    sepia::make_unique<sepia::char_parameter>(216),
+                    "follower",
+                    sepia::make_unique<sepia::char_parameter>(239),
+                    "event_source_amplifier",
+                    sepia::make_unique<sepia::char_parameter>(42),
+                    "on_event_threshold",
+                    sepia::make_unique<sepia::char_parameter>(51),
+                    "off_event_threshold",
+                    sepia::make_unique<sepia::char_parameter>(39),
+                    "off_event_inverter",
+                    sepia::make_unique<sepia::char_parameter>(61),
+                    "cascode_photoreceptor_feedback",
+                    sepia::make_unique<sepia::char_parameter>(154)),
+                "exposure_measurement",
+                sepia::make_unique<sepia::object_parameter>(
+                    "comparator_tail",
+                    sepia::make_unique<sepia::char_parameter>(54),
+                    "comparator_hysteresis",
+                    sepia::make_unique<sepia::char_parameter>(47),
+                    "comparator_output_stage",
+                    sepia::make_unique<sepia::char_parameter>(57),
+                    "upper_threshold",
+                    sepia::make_unique<sepia::char_parameter>(243),
+                    "lower_threshold",
+                    sepia::make_unique<sepia::char_parameter>(235)),
+                "pullup",
+                sepia::make_unique<sepia::object_parameter>(
+                    "exposure_measurement_abscissa_request",
+                    sepia::make_unique<sepia::char_parameter>(131),
+                    "exposure_measurement_ordinate_request",
+                    sepia::make_unique<sepia::char_parameter>(155),
+                    "change_detection_abscissa_request",
+                    sepia::make_unique<sepia::char_parameter>(151),
+                    "change_detection_ordinate_request",
+                    sepia::make_unique<sepia::char_parameter>(117),
+                    "abscissa_acknoledge",
+                    sepia::make_unique<sepia::char_parameter>(162),
+                    "abscissa_encoder",
+                    sepia::make_unique<sepia::char_parameter>(162),
+                    "ordinate_encoder",
+                    sepia::make_unique<sepia::char_parameter>(120)),
+                "control",
+                sepia::make_unique<sepia::object_parameter>(
+                    "exposure_measurement_timeout",
+                    sepia::make_unique<sepia::char_parameter>(49),
+                    "sequential_exposure_measurement_timeout",
+                    sepia::make_unique<sepia::char_parameter>(45),
+                    "abscissa_acknoledge_timeout",
+                    sepia::make_unique<sepia::char_parameter>(56),
+                    "latch_cell_scan_pulldown",
+                    sepia::make_unique<sepia::char_parameter>(134),
+                    "abscissa_request_pulldown",
+                    sepia::make_unique<sepia::char_parameter>(87)));
+        }
+
+        /// width returns the sensor width.
+        static constexpr uint16_t width() {
+            return 304;
+        }
+
+        /// height returns the sensor height.
+        static constexpr uint16_t height() {
+            return 240;
+        }
+
+        /// dac describes a digital-to-analog converter on the FPGA.
+        struct dac {
+            /// category is the converter's parameter category, or "static" for constant converters.
+            const char* category;
+
+            /// name is the converter's parameter name.
+            const char* name;
+
+            /// address is the converter's address on the FPGA.
+            uint8_t address;
+
+            /// tension is the converter's reference tension.
+            uint16_t tension;
+
+            /// value is the constant value of static converters.
+            uint8_t value;
+        };
+
+        /// dacs lists the digital-to-analog converters on the FPGA, sorted by address.
+        static constexpr std::array<dac, 29> dacs() {
+            return {{
+                {"static", "reset_t", 0x00, 0x5900, 0},
+                {"static", "test_event", 0x01, 0x7900, 0},
+                {"change_detection", "reset_switch_bulk_potential", 0x02, 0x5900, 0},
+                {"change_detection", "photoreceptor_feedback", 0x03, 0x5900, 0},
+                {"change_detection", "refractory_period", 0x04, 0x5900, 0},
+                {"change_detection", "follower", 0x05, 0x5900, 0},
+                {"change_detection", "event_source_amplifier", 0x06, 0x7900, 0},
+                {"change_detection", "on_event_threshold", 0x07, 0x7900, 0},
+                {"change_detection", "off_event_threshold", 0x08, 0x7900, 0},
+                {"change_detection", "off_event_inverter", 0x09, 0x7900, 0},
+                {"change_detection", "cascode_photoreceptor_feedback", 0x0a, 0x7900, 0},
+                {"exposure_measurement", "comparator_tail", 0x0b, 0x7900, 0},
+                {"exposure_measurement", "comparator_hysteresis", 0x0c, 0x7900, 0},
+                {"exposure_measurement", "comparator_output_stage", 0x0d, 0x7900, 0},
+                {"exposure_measurement", "upper_threshold", 0x0e, 0x5900, 0},
+                {"exposure_measurement", "lower_threshold", 0x0f, 0x5900, 0},
+                {"pullup", "exposure_measurement_abscissa_request", 0x10, 0x5900, 0},
+                {"pullup", "exposure_measurement_ordinate_request", 0x11, 0x5900, 0},
+                {"pullup", "change_detection_abscissa_request", 0x12, 0x5900, 0},
+                {"pullup", "change_detection_ordinate_request", 0x13, 0x7900, 0},
+                {"pullup", "abscissa_acknoledge", 0x14, 0x5900, 0},
+                {"pullup", "abscissa_encoder", 0x15, 0x5900, 0},
+                {"pullup", "ordinate_encoder", 0x16, 0x7900, 0},
+                {"control", "exposure_measurement_timeout", 0x17, 0x7900, 0},
+                {"control", "sequential_exposure_measurement_timeout", 0x18, 0x7900, 0},
+                {"control", "abscissa_acknoledge_timeout", 0x19, 0x7900, 0},
+                {"control", "latch_cell_scan_pulldown", 0x1a, 0x5900, 0},
+                {"control", "abscissa_request_pulldown", 0x1b, 0x7900, 0},
+                {"static", "reset_photodiodes", 0x1c, 0x00, 3},
+            }};
+        }
+
+        /// bias_template holds the parts of the bias packet that do not depend on the parameter.
+        struct bias_template {
+            /// packet contains the value, tension and address of every converter (big-endian words),
+            /// with zero values for the converters read from the parameter.
+            std::array<uint8_t, 29 * 12> packet;
+
+            /// parameter_converters lists the indices of the converters read from the parameter.
+            std::vector<std::size_t> parameter_converters;
+        };
+
+        /// bias_packet_template returns the constant parts of the bias packet, built on the first call.
+        static const bias_template& bias_packet_template() {
+            static const bias_template result = []() -> bias_template {
+                bias_template packet_template;
+                const auto converters = dacs();
+                for (std::size_t index = 0; index < converters.size(); ++index) {
+                    const auto& converter = converters[index];
+                    const auto is_static = std::strcmp(converter.category, "static") == 0;
+                    if (!is_static) {
+                        packet_template.parameter_converters.push_back(index);
+                    }
+                    write_bias_word(
+                        packet_template.packet, index, 0, is_static ? static_cast<uint32_t>(converter.value) : 0);
+                    write_bias_word(packet_template.packet, index, 1, converter.tension);
+                    write_bias_word(packet_template.packet, index, 2, converter.address);
+                }
+                return packet_template;
+            }();
+            return result;
+        }
+
+        /// bias_packet serializes the value, tension and address of every converter.
+        /// Only the values depend on the parameter, they are written over a copy of bias_packet_template.
+        static std::array<uint8_t, 29 * 12> bias_packet(const sepia::parameter& parameter) {
+            const auto& packet_template = bias_packet_template();
+            auto packet = packet_template.packet;
+            const auto converters = dacs();
+            for (const auto index : packet_template.parameter_converters) {
+                write_bias_word(
+                    packet,
+                    index,
+                    0,
+                    static_cast<uint32_t>(parameter.get_number({converters[index].category, converters[index].name})));
+            }
+            return packet;
+        }
+
+        /// configuration contains the settings for the digital-to-analog converters on the FPGA.
+        /// It is generated from dacs on every call, and is deprecated in favour of dacs and bias_packet.
+        CCAM_ATIS_SEPIA_DEPRECATED("use dacs and bias_packet instead")
+        static std::
+            unordered_map<std::string, std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>>>
+            configuration() {
+            std::unordered_map<
+                std::string,
+                std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>>>
+                result;
+            for (const auto& converter : dacs()) {
+                auto& setting = result[converter.category][converter.name];
+                setting["address"] = converter.address;
+                setting["tension"] = converter.tension;
+                if (std::strcmp(converter.category, "static") == 0) {
+                    setting["value"] = converter.value;
+                }
+            }
+            return result;
+        }
+
+        camera() = default;
+        camera(const camera&) = delete;
+        camera(camera&&) = default;
+        camera& operator=(const camera&) = delete;
+        camera& operator=(camera&&) = default;
+        virtual ~camera() {}
+
+        /// trigger sends a trigger signal to the camera.
+        /// with default settings, this signal will trigger a change detection on every pixel.
+        virtual void trigger() = 0;
+
+        /// statistics returns the acquisition counters.
+        /// It can be called from any thread.
+        virtual acquisition_statistics statistics() const = 0;
+
+        protected:
+        /// write_bias_word writes the big-endian word at word_index (0 for the value, 1 for the tension
+        /// and 2 for the address) in the given converter's entry.
+        static void write_bias_word(
+            std::array<uint8_t, 29 * 12>& packet,
+            std::size_t index,
+            std::size_t word_index,
+            uint32_t word) {
+            for (std::size_t byte_index = 0; byte_index < 4; ++byte_index) {
+                packet[index * 12 + word_index * 4 + byte_index] =
+                    static_cast<uint8_t>((word >> (8 * (3 - byte_index))) & 0xff);
+            }
+        }
+
+        /// check_usb_error throws if the given value is not zero.
+        static void check_usb_error(int error, const std::string& message) {
+            if (error < 0) {
+                throw std::logic_error(message + " failed: " + libusb_strerror(static_cast<libusb_error>(error)));
+            }
+        }
+
+        /// send_command sends a setup command to the given camera.
+        static void send_command(
+            libusb_device_handle* handle,
+            uint16_t w_value,
+            std::array<uint8_t, 4> data,
+            const std::string& message) {
+            check_usb_error(
+                libusb_control_transfer(handle, 64, 86, w_value, 0, data.data(), static_cast<uint16_t>(data.size()), 0),
+                message);
+        }
+    };
+
+    /// overflow_mode selects the behaviour of a camera whose FIFO is full.
+    enum class overflow_mode : uint8_t {
+        /// fail stops the acquisition with a "computer's FIFO overflow" exception.
+        fail,
+
+        /// drop_newest discards the events that do not fit in the FIFO.
+        drop_newest,
+
+        /// drop_oldest makes the consumer skip the oldest waiting events, as many as the rest of the current transfer
+        /// needs. The acquisition thread does not wait for the consumer: the events that do not fit before the
+        /// consumer has skipped are discarded. Buffered cameras skip one waiting buffer per buffer that does not fit.
+        drop_oldest,
+
+        /// decimate keeps one event out of decimation per block of pixels above the shedding threshold,
+        /// and discards the events that still do not fit in the FIFO.
+        decimate,
+
+        /// drop_threshold_crossings_first discards exposure measurement events above the shedding threshold,
+        /// and discards the events that still do not fit in the FIFO.
+        drop_threshold_crossings_first,
+    };
+
+    /// overflow_policy configures the behaviour of a camera whose FIFO fills up.
+    struct overflow_policy {
+        overflow_policy(
+            overflow_mode mode_to_use = overflow_mode::fail,
+            double shedding_threshold_to_use = 0.75,
+            uint16_t decimation_to_use = 4,
+            uint16_t block_size_to_use = 16) :
+            mode(mode_to_use),
+            shedding_threshold(shedding_threshold_to_use),
+            decimation(decimation_to_use),
+            block_size(block_size_to_use) {}
+
+        /// mode is the overflow behaviour.
+        overflow_mode mode;
+
+        /// shedding_threshold is the FIFO occupancy, as a fraction of its capacity,
+        /// above which the decimate and drop_threshold_crossings_first modes discard events.
+        double shedding_threshold;
+
+        /// decimation is the number of events per block for each event kept in decimate mode.
+        uint16_t decimation;
+
+        /// block_size is the width and height in pixels of the blocks used in decimate mode.
+        uint16_t block_size;
+    };
+
+    /// event_shedder implements the threshold-based overflow modes.
+    class event_shedder {
+        public:
+        event_shedder(overflow_policy policy, std::size_t capacity) :
+            _policy(policy),
+            _threshold(std::numeric_limits<std::size_t>::max()),
+            _blocks_per_row(0) {
+            if (_policy.shedding_threshold < 0 || _policy.shedding_threshold > 1) {
+                throw std::logic_error("the shedding threshold must be in the range [0, 1]");
+            }
+            if (_policy.decimation == 0 || _policy.block_size == 0) {
+                throw std::logic_error("the decimation and the block size must be larger than zero");
+            }
+            if (_policy.mode == overflow_mode::decimate
+                || _policy.mode == overflow_mode::drop_threshold_crossings_first) {
+                _threshold = static_cast<std::size_t>(_policy.shedding_threshold * static_cast<double>(capacity));
+            }
+            if (_policy.mode == overflow_mode::decimate) {
+                _blocks_per_row = (camera::width() + _policy.block_size - 1) / _policy.block_size;
+                _counts.resize(
+                    _blocks_per_row * ((camera::height() + _policy.block_size - 1) / _policy.block_size), 0);
+            }
+        }
+        event_shedder(const event_shedder&) = default;
+        event_shedder(event_shedder&&) = default;
+        event_shedder& operator=(const event_shedder&) = default;
+        event_shedder& operator=(event_shedder&&) = default;
+        virtual ~event_shedder() {}
+
+        /// policy returns the overflow policy.
+        const overflow_policy& policy() const {
+            return _policy;
+        }
+
+        /// shed returns true if the event must be discarded, given the FIFO occupancy.
+        bool shed(sepia::atis_event event, std::size_t occupancy) {
+            if (occupancy < _threshold) {
+                return false;
+            }
+            if (_policy.mode == overflow_mode::drop_threshold_crossings_first) {
+                return event.is_threshold_crossing;
+            }
+            if (event.x >= camera::width() || event.y >= camera::height()) {
+                return false;
+            }
+            auto& count = _counts[(event.y / _policy.block_size) * _blocks_per_row + event.x / _policy.block_size];
+            ++count;
+            if (count >= _policy.decimation) {
+                count = 0;
+                return false;
+            }
+            return true;
+        }
+
+        protected:
+        overflow_policy _policy;
+        std::size_t _threshold;
+        std::size_t _blocks_per_row;
+        std::vector<uint16_t> _counts;
+    };
+
+    /// grey_level_frame is a published grey-level image.
+    struct grey_level_frame {
+        /// t is the timestamp of the last event taken into account.
+        uint64_t t;
+
+        /// pixels contains camera::width() * camera::height() grey levels in [0, 1].
+        /// Pixel (x, y) is at index y * camera::width() + x.
+        /// Pixels whose exposure has not been measured yet are 0.
+        const float* pixels;
+    };
+
+    /// grey_level_reconstructor converts exposure measurements into a grey-level image.
+    /// The first threshold crossing of a pixel (polarity false) stores its timestamp,
+    /// and the second (polarity true) updates the pixel's grey level in place from the exposure duration.
+    /// Exposures are mapped logarithmically, minimum_exposure being white and maximum_exposure black.
+    /// Every snapshot_period microseconds of event time (counted from the first event), the working image is swapped
+    /// into a triple buffer, so that a reader thread can access the latest frame without copy or lock while events
+    /// keep coming. The image swapped out is brought up to date by copying the cache lines written since it was
+    /// published, which are tracked with a publication stamp per line.
+    /// handle must be called from a single thread, and snapshot from another single thread.
+    class grey_level_reconstructor {
+        public:
+        grey_level_reconstructor(
+            uint64_t snapshot_period = 20000,
+            uint64_t minimum_exposure = 10,
+            uint64_t maximum_exposure = 1000000) :
+            _snapshot_period(snapshot_period),
+            _next_snapshot_t(0),
+            _has_first_event(false),
+            _logarithm_of_maximum_exposure(std::log(static_cast<float>(maximum_exposure))),
+            _inverse_logarithmic_range(
+                1.0f
+                / (std::log(static_cast<float>(maximum_exposure)) - std::log(static_cast<float>(minimum_exposure)))),
+            _blocks(nullptr),
+            _line_stamps(lines(), 0),
+            _publications(1),
+            _t(0),
+            _write_index(0),
+            _ready(1),
+            _read_index(2) {
+            if (minimum_exposure == 0 || minimum_exposure >= maximum_exposure) {
+                throw std::logic_error("the minimum exposure must be non-zero and smaller than the maximum exposure");
+            }
+            // first crossings and three images (working, ready and read), each on its own cache lines
+            const auto size = first_crossings_size() + 3 * image_size();
+#if defined(_WIN32)
+            _blocks = static_cast<uint8_t*>(_aligned_malloc(size, 64));
+#else
+            {
+                void* blocks;
+                if (posix_memalign(&blocks, 64, size) == 0) {
+                    _blocks = static_cast<uint8_t*>(blocks);
+                }
+            }
+#endif
+            if (_blocks == nullptr) {
+                throw std::bad_alloc();
+            }
+            _first_crossings = reinterpret_cast<uint64_t*>(_blocks);
+            std::fill_n(_first_crossings, pixels(), std::numeric_limits<uint64_t>::max());
+            for (uint32_t index = 0; index < 3; ++index) {
+                std::fill_n(frame_pixels(index), pixels(), 0.0f);
+                _frame_ts[index] = 0;
+                _frame_stamps[index] = 0;
+            }
+            _image = frame_pixels(_write_index);
+        }
+        grey_level_reconstructor(const grey_level_reconstructor&) = delete;
+        grey_level_reconstructor(grey_level_reconstructor&&) = delete;
+        grey_level_reconstructor& operator=(const grey_level_reconstructor&) = delete;
+        grey_level_reconstructor& operator=(grey_level_reconstructor&&) = delete;
+        virtual ~grey_level_reconstructor() {
+#if defined(_WIN32)
+            _aligned_free(_blocks);
+#else
+            std::free(_blocks);
+#endif
+        }
+
+        /// handle updates the image with an event, change detections only advance the time.
+        void handle(sepia::atis_event event) {
+            if (_snapshot_period > 0) {
+                if (!_has_first_event) {
+                    _has_first_event = true;
+                    _next_snapshot_t = event.t + _snapshot_period;
+                } else if (event.t >= _next_snapshot_t) {
+                    publish();
+                    _next_snapshot_t += (event.t - _next_snapshot_t) / _snapshot_period * _snapshot_period
+                                        + _snapshot_period;
+                }
+            }
+            _t = event.t;
+            if (!event.is_threshold_crossing || event.x >= camera::width() || event.y >= camera::height()) {
+                return;
+            }
+            const auto index = static_cast<std::size_t>(event.y) * camera::width() + event.x;
+            if (event.polarity) {
+                const auto first_crossing = _first_crossings[index];
+                if (first_crossing < event.t) {
+                    const auto grey_level =
+                        (_logarithm_of_maximum_exposure - std::log(static_cast<float>(event.t - first_crossing)))
+                        * _inverse_logarithmic_range;
+                    _image[index] = grey_level < 0.0f ? 0.0f : (grey_level > 1.0f ? 1.0f : grey_level);
+                    _line_stamps[index / pixels_per_line()] = _publications;
+                }
+                _first_crossings[index] = std::numeric_limits<uint64_t>::max();
+            } else {
+                _first_crossings[index] = event.t;
+            }
+        }
+
+        /// operator() calls handle, so that a reference wrapper can be used as an event handler.
+        void operator()(sepia::atis_event event) {
+            handle(event);
+        }
+
+        /// image returns the working image, and must only be called from the thread calling handle.
+        /// The pointer is valid until the next call to publish.
+        const float* image() const {
+            return _image;
+        }
+
+        /// publish swaps the working image into the triple buffer, and takes back the oldest image as working image.
+        /// It is called by handle at the snapshot rate, and can be called manually from the same thread.
+        void publish() {
+            const auto published_index = _write_index;
+            _frame_ts[published_index] = _t;
+            _frame_stamps[published_index] = _publications;
+            ++_publications;
+            _write_index = _ready.exchange(published_index | fresh, std::memory_order_acq_rel) & ~fresh;
+            // the new working image misses the lines written after it was last published
+            const auto published = frame_pixels(published_index);
+            _image = frame_pixels(_write_index);
+            const auto stamp = _frame_stamps[_write_index];
+            for (std::size_t line = 0; line < _line_stamps.size(); ++line) {
+                if (_line_stamps[line] > stamp) {
+                    const auto begin = line * pixels_per_line();
+                    std::copy_n(published + begin, std::min(pixels_per_line(), pixels() - begin), _image + begin);
+                }
+            }
+        }
+
+        /// snapshot returns the latest published frame.
+        /// The frame's pixels remain valid and unchanged until the next call to snapshot.
+        grey_level_frame snapshot() {
+            if ((_ready.load(std::memory_order_relaxed) & fresh) != 0) {
+                _read_index = _ready.exchange(_read_index, std::memory_order_acq_rel) & ~fresh;
+            }
+            grey_level_frame frame;
+            frame.t = _frame_ts[_read_index];
+            frame.pixels = frame_pixels(_read_index);
+            return frame;
+        }
+
+        protected:
+        /// fresh marks a published frame that has not been read yet.
+        static constexpr uint32_t fresh = 4;
+
+        /// pixels returns the number of pixels in an image.
+        static constexpr std::size_t pixels() {
+            return static_cast<std::size_t>(camera::width()) * camera::height();
+        }
+
+        /// pixels_per_line returns the number of pixels in a cache line.
+        static constexpr std::size_t pixels_per_line() {
+            return 64 / sizeof(float);
+        }
+
+        /// lines returns the number of cache lines in an image.
+        static constexpr std::size_t lines() {
+            return (pixels() + pixels_per_line() - 1) / pixels_per_line();
+        }
+
+        /// first_crossings_size returns the number of bytes used by the first crossings, rounded up to a cache line.
+        static constexpr std::size_t first_crossings_size() {
+            return (pixels() * sizeof(uint64_t) + 63) / 64 * 64;
+        }
+
+        /// image_size returns the number of bytes used by an image, rounded up to a cache line.
+        static constexpr std::size_t image_size() {
+            return (pixels() * sizeof(float) + 63) / 64 * 64;
+        }
+
+        /// frame_pixels returns the pixels of the image with the given index.
+        float* frame_pixels(uint32_t index) const {
+            return reinterpret_cast<float*>(_blocks + first_crossings_size() + index * image_size());
+        }
+
+        const uint64_t _snapshot_period;
+        uint64_t _next_snapshot_t;
+        bool _has_first_event;
+        const float _logarithm_of_maximum_exposure;
+        const float _inverse_logarithmic_range;
+        uint8_t* _blocks;
+        uint64_t* _first_crossings;
+        float* _image;
+        std::vector<uint64_t> _line_stamps;
+        uint64_t _publications;
+        uint64_t _t;
+        std::array<uint64_t, 3> _frame_ts;
+        std::array<uint64_t, 3> _frame_stamps;
+        uint32_t _write_index;
+        std::atomic<uint32_t> _ready;
+        uint32_t _read_index;
+    };
+
+    /// scheduling selects the scheduling policy of a thread.
+    enum class scheduling {
+        /// inherit keeps the default policy.
+        inherit,
+
+        /// fifo requests SCHED_FIFO, which usually requires elevated privileges.
+        fifo,
+
+        /// round_robin requests SCHED_RR, which usually requires elevated privileges.
+        round_robin,
+    };
+
+    /// thread_placement determines where and how a thread runs.
+    struct thread_placement {
+        thread_placement(
+            int32_t cpu_to_use = -1,
+            scheduling scheduling_to_use = scheduling::inherit,
+            int32_t priority_to_use = 0) :
+            cpu(cpu_to_use),
+            scheduling(scheduling_to_use),
+            priority(priority_to_use) {}
+
+        /// cpu is the core the thread is pinned to, or -1 to let the operating system choose.
+        int32_t cpu;
+
+        /// scheduling is the thread's scheduling policy.
+        ccam_atis_sepia::scheduling scheduling;
+
+        /// priority is the real-time priority used with the fifo and round_robin policies.
+        int32_t priority;
+    };
+
+    /// placement_policy determines the placement of a camera's threads and memory.
+    struct placement_policy {
+        placement_policy(
+            thread_placement acquisition_to_use = thread_placement(),
+            thread_placement consumer_to_use = thread_placement(),
+            bool local_memory_to_use = false,
+            bool lock_memory_to_use = false) :
+            acquisition(acquisition_to_use),
+            consumer(consumer_to_use),
+            local_memory(local_memory_to_use),
+            lock_memory(lock_memory_to_use) {}
+
+        /// acquisition is the placement of the thread reading from USB.
+        thread_placement acquisition;
+
+        /// consumer is the placement of the thread calling the event or buffer handler.
+        thread_placement consumer;
+
+        /// local_memory moves the transfer buffers and the FIFO to the acquisition thread's NUMA node.
+        bool local_memory;
+
+        /// lock_memory prevents the transfer buffers and the FIFO from being paged out.
+        bool lock_memory;
+    };
+
+    /// placement_outcome reports whether a placement option was applied.
+    enum class placement_outcome {
+        /// not_requested means that the option was left to its default.
+        not_requested,
+
+        /// applied means that the option is in effect.
+        applied,
+
+        /// failed means that the operating system refused or does not support the option.
+        /// The acquisition runs regardless, with the default behaviour.
+        failed,
+    };
+
+    /// placement_report holds the outcome of each option of a placement_policy.
+    struct placement_report {
+        placement_report() :
+            acquisition_affinity(placement_outcome::not_requested),
+            acquisition_scheduling(placement_outcome::not_requested),
+            consumer_affinity(placement_outcome::not_requested),
+            consumer_scheduling(placement_outcome::not_requested),
+            local_memory(placement_outcome::not_requested),
+            locked_memory(placement_outcome::not_requested) {}
+
+        placement_outcome acquisition_affinity;
+        placement_outcome acquisition_scheduling;
+        placement_outcome consumer_affinity;
+        placement_outcome consumer_scheduling;
+        placement_outcome local_memory;
+        placement_outcome locked_memory;
+    };
+
+    /// current_thread returns the native handle of the calling thread.
+    inline std::thread::native_handle_type current_thread() {
+#if defined(_WIN32)
+        return std::thread::native_handle_type();
+#else
+        return pthread_self();
+#endif
+    }
+
+    /// set_thread_affinity pins a thread to a core (only supported on Linux).
+    inline placement_outcome set_thread_affinity(std::thread::native_handle_type thread, int32_t cpu) {
+        if (cpu < 0) {
+            return placement_outcome::not_requested;
+        }
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        return pthread_setaffinity_np(thread, sizeof(cpus), &cpus) == 0 ? placement_outcome::applied :
+                                                                          placement_outcome::failed;
+#else
+        return placement_outcome::failed;
+#endif
+    }
+
+    /// set_thread_scheduling changes the scheduling policy of a thread (only supported on POSIX systems).
+    inline placement_outcome
+    set_thread_scheduling(std::thread::native_handle_type thread, scheduling policy, int32_t priority) {
+        if (policy == scheduling::inherit) {
+            return placement_outcome::not_requested;
+        }
+#if defined(_WIN32)
+        return placement_outcome::failed;
+#else
+        sched_param parameter;
+        parameter.sched_priority = priority;
+        return pthread_setschedparam(thread, policy == scheduling::fifo ? SCHED_FIFO : SCHED_RR, &parameter) == 0 ?
+                   placement_outcome::applied :
+                   placement_outcome::failed;
+#endif
+    }
+
+    /// memory_region is a range of bytes.
+    typedef std::pair<void*, std::size_t> memory_region;
+
+    /// bind_to_current_node moves memory regions to the NUMA node of the core running the calling thread.
+    /// It uses the mbind system call directly, hence libnuma is not required (only supported on Linux).
+    /// Regions are extended to whole pages.
+    inline placement_outcome bind_to_current_node(const std::vector<memory_region>& regions) {
+#if defined(__linux__) && defined(SYS_getcpu) && defined(SYS_mbind)
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= sizeof(unsigned long) * 8) {
+            return placement_outcome::failed;
+        }
+        const unsigned long nodes = 1ul << node;
+        const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        for (const auto& region : regions) {
+            if (region.second == 0) {
+                continue;
+            }
+            const auto begin = reinterpret_cast<uintptr_t>(region.first) / page_size * page_size;
+            const auto end =
+                (reinterpret_cast<uintptr_t>(region.first) + region.second + page_size - 1) / page_size * page_size;
+            // 2 is MPOL_BIND and 2 is also MPOL_MF_MOVE (see numaif.h)
+            if (syscall(SYS_mbind, begin, end - begin, 2, &nodes, sizeof(nodes) * 8, 2) != 0) {
+                return placement_outcome::failed;
+            }
+        }
+        return placement_outcome::applied;
+#else
+        return placement_outcome::failed;
+#endif
+    }
+
+    /// lock_regions prevents memory regions from being paged out (only supported on POSIX systems).
+    /// The amount of locked memory is usually limited for unprivileged users (see RLIMIT_MEMLOCK).
+    inline placement_outcome lock_regions(const std::vector<memory_region>& regions) {
+#if defined(_WIN32)
+        return placement_outcome::failed;
+#else
+        for (const auto& region : regions) {
+            if (region.second > 0 && mlock(region.first, region.second) != 0) {
+                return placement_outcome::failed;
+            }
+        }
+        return placement_outcome::applied;
+#endif
+    }
+
+    /// jitter_statistics summarises the wake-up lateness of a periodic thread.
+    struct jitter_statistics {
+        /// affinity and scheduling are the outcomes of the measured thread's placement.
+        placement_outcome affinity;
+        placement_outcome scheduling;
+
+        /// mean, median, percentile_99 and maximum are wake-up latenesses, in nanoseconds.
+        uint64_t mean;
+        uint64_t median;
+        uint64_t percentile_99;
+        uint64_t maximum;
+    };
+
+    /// measure_wakeup_jitter runs a thread with the given placement that wakes up every period,
+    /// and measures how late each wake-up is. It blocks for about samples * period.
+    /// Running it with and without a placement shows the scheduling jitter an acquisition thread would see.
+    inline jitter_statistics measure_wakeup_jitter(
+        thread_placement placement,
+        std::chrono::microseconds period = std::chrono::microseconds(1000),
+        std::size_t samples = 10000) {
+        jitter_statistics statistics;
+        std::vector<uint64_t> latenesses;
+        latenesses.reserve(samples);
+        std::thread measurement([&]() -> void {
+            statistics.affinity = set_thread_affinity(current_thread(), placement.cpu);
+            statistics.scheduling = set_thread_scheduling(current_thread(), placement.scheduling, placement.priority);
+            auto wakeup = std::chrono::steady_clock::now();
+            for (std::size_t index = 0; index < samples; ++index) {
+                wakeup += period;
+                std::this_thread::sleep_until(wakeup);
+                latenesses.push_back(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wakeup)
+                        .count()));
+            }
+        });
+        measurement.join();
+        statistics.mean = 0;
+        statistics.median = 0;
+        statistics.percentile_99 = 0;
+        statistics.maximum = 0;
+        if (!latenesses.empty()) {
+            std::sort(latenesses.begin(), latenesses.end());
+            uint64_t sum = 0;
+            for (const auto lateness : latenesses) {
+                sum += lateness;
+            }
+            statistics.mean = sum / latenesses.size();
+            statistics.median = latenesses[latenesses.size() / 2];
+            statistics.percentile_99 = latenesses[(latenesses.size() * 99) / 100];
+            statistics.maximum = latenesses.back();
+        }
+        return statistics;
+    }
+
+    /// reconnect_policy determines whether a camera opens the device again after a disconnection.
+    struct reconnect_policy {
+        reconnect_policy(
+            bool enabled_to_use = false,
+            std::chrono::milliseconds retry_interval_to_use = std::chrono::milliseconds(200),
+            std::size_t maximum_attempts_to_use = 0) :
+            enabled(enabled_to_use),
+            retry_interval(retry_interval_to_use),
+            maximum_attempts(maximum_attempts_to_use) {}
+
+        /// enabled is false by default, in which case a disconnection ends the acquisition.
+        bool enabled;
+
+        /// retry_interval is the delay between two attempts to open the device.
+        std::chrono::milliseconds retry_interval;
+
+        /// maximum_attempts is the number of attempts before giving up, or zero to retry until stopped.
+        std::size_t maximum_attempts;
+    };
+
+    /// gap describes an interruption of the event stream caused by a reconnection.
+    /// Timestamps remain monotonic: the stream resumes at end, which accounts for the reconnection's duration.
+    struct gap {
+        /// begin is the timestamp of the last word received before the disconnection.
+        uint64_t begin;
+
+        /// end is the timestamp from which events were acquired after the reconnection.
+        uint64_t end;
+
+        /// lost_events is an estimate of the number of events lost, based on the mean event rate.
+        uint64_t lost_events;
+    };
+
+    /// bring_up_timings holds the duration of each step of a camera's bring-up.
+    struct bring_up_timings {
+        /// initialization is the time spent creating the USB context.
+        std::chrono::microseconds initialization;
+
+        /// enumeration is the time spent finding and opening the device.
+        std::chrono::microseconds enumeration;
+
+        /// reset is the time spent resetting the device.
+        std::chrono::microseconds reset;
+
+        /// configuration is the time spent sending the role, biases and mode.
+        std::chrono::microseconds configuration;
+
+        /// drain is the time spent reading stale data.
+        std::chrono::microseconds drain;
+
+        /// start is the time spent sending the start commands.
+        std::chrono::microseconds start;
+    };
+
+    /// bias_change describes a bias update applied while the acquisition is running.
+    /// Events with a timestamp between t and applied_t may have been generated with either set of biases.
+    struct bias_change {
+        /// t is the timestamp of the last event received before the update was sent.
+        uint64_t t;
+
+        /// applied_t is the timestamp of the last event of the first transfer completed after the update was sent.
+        /// It is std::numeric_limits<uint64_t>::max() until such a transfer completes (see usb_camera::bias_changes).
+        uint64_t applied_t;
+
+        /// converters is the number of digital-to-analog converters whose value changed.
+        std::size_t converters;
+    };
+
+    /// byte_sink decodes the raw bytes of a CCam ATIS, whatever their source.
+    /// It records the bytes if a raw file was requested, extends the timestamps across transfers, applies the pixel
+    /// mask and measures the stream, then passes the bytes to a delivery class through handle_bytes.
+    /// Delivery classes (event_delivery, buffer_delivery and shared_memory_delivery) take their source as a template
+    /// parameter: usb_camera for a live camera, replay_source for a raw file, or byte_sink itself.
+    /// A delivery built on byte_sink has no source, and its bytes are passed to dispatch_bytes by a derived class,
+    /// so that the delivery paths can be tested and measured without hardware.
+    /// Derived classes must call start once fully constructed and stop in their destructor.
+    class byte_sink : public camera {
+        protected:
+        byte_sink(const std::string& raw_filename, std::shared_ptr<const pixel_mask> mask, placement_policy placement) :
+            _mask(std::move(mask)),
+            _latest_t(0),
+            _placement_policy(placement) {
+            if (!raw_filename.empty()) {
+                _raw_recorder = sepia::make_unique<raw_recorder>(raw_filename, 1 << 22, 16);
+            }
+        }
+
+        public:
+        byte_sink(const byte_sink&) = delete;
+        byte_sink(byte_sink&&) = default;
+        byte_sink& operator=(const byte_sink&) = delete;
+        byte_sink& operator=(byte_sink&&) = default;
+        virtual ~byte_sink() {}
+        virtual void trigger() override {}
+
+        /// set_mask replaces the pixel mask, and can be called from any thread while the acquisition is running.
+        /// A null mask keeps every event.
+        virtual void set_mask(std::shared_ptr<const pixel_mask> mask) {
+            std::atomic_store(&_mask, std::move(mask));
+        }
+
+        virtual acquisition_statistics statistics() const override {
+            auto statistics = _telemetry.snapshot();
+            if (_raw_recorder) {
+                statistics.dropped_raw_chunks = _raw_recorder->dropped_chunks();
+                statistics.raw_direct_io = _raw_recorder->direct_io();
+            }
+            return statistics;
+        }
+
+        /// clock_fit returns the current model mapping event timestamps to host time.
+        /// The model is updated after each transfer, and can be used to convert a batch of events.
+        virtual host_clock_fit clock_fit() const {
+            return _clock.fit();
+        }
+
+        /// host_time converts an event timestamp to host time with the current model.
+        virtual std::chrono::steady_clock::time_point host_time(uint64_t t) const {
+            return _clock.fit().host_time(t);
+        }
+
+        /// placement returns the outcome of the placement options.
+        virtual placement_report placement() const {
+            return _placement_report;
+        }
+
+        protected:
+        /// start launches the source's thread, if any.
+        /// Without source, bytes are passed to dispatch_bytes by the caller, hence there is nothing to start.
+        virtual void start() {}
+
+        /// stop terminates the source's thread, if any, and must be called before the derived object is destroyed.
+        virtual void stop() {}
+
+        /// dispatch_bytes records the raw bytes if a raw file was requested, then passes them to handle_bytes.
+        /// It must be called by a single thread at a time, which plays the role of the acquisition thread.
+        /// Delivery errors (for example a FIFO overflow with overflow_mode::fail) are thrown to the caller.
+        virtual void dispatch_bytes(const uint8_t* bytes, std::size_t size, bool timed_out) {
+            const auto decode_begin = std::chrono::steady_clock::now();
+            if (_raw_recorder) {
+                _raw_recorder->write(bytes, size);
+            }
+            if (size % 4 != 0) {
+                _telemetry.add_short_transfer();
+            }
+            const auto previous_overflow_words = _decode_state.overflow_words;
+            const auto previous_masked_events = _decode_state.masked_events;
+            const auto previous_counter_discontinuities = _decode_state.counter_discontinuities;
+            // the first word boundary follows the bytes that complete the previous transfer's partial word
+            const auto previous_partial_size = static_cast<std::size_t>(_decode_state.partial_size);
+            const auto head = (4 - previous_partial_size) % 4;
+            _transfer_mask = std::atomic_load(&_mask);
+            handle_bytes(bytes, size);
+            if (size >= head + 4) {
+                const auto last_word = bytes + (head + (size - head) / 4 * 4 - 4);
+                _latest_t.store(
+                    last_word[3] == 0x80 ?
+                        _decode_state.t_offset :
+                        _decode_state.t_offset
+                            + ((static_cast<uint64_t>(last_word[3] & 0xf) << 7) | (last_word[2] >> 1)),
+                    std::memory_order_release);
+                _clock.add(_latest_t.load(std::memory_order_relaxed), decode_begin);
+            }
+            const auto overflow_words =
+                static_cast<std::size_t>(_decode_state.overflow_words - previous_overflow_words);
+            if (_decode_state.masked_events > previous_masked_events) {
+                _telemetry.add_masked_events(
+                    static_cast<std::size_t>(_decode_state.masked_events - previous_masked_events));
+            }
+            if (_decode_state.counter_discontinuities > previous_counter_discontinuities) {
+                _telemetry.add_counter_discontinuities(static_cast<std::size_t>(
+                    _decode_state.counter_discontinuities - previous_counter_discontinuities));
+            }
+            _telemetry.add_transfer(
+                timed_out,
+                size,
+                (previous_partial_size + size) / 4 - overflow_words,
+                overflow_words,
+                fifo_occupancy(),
+                decode_begin,
+                std::chrono::steady_clock::now());
+        }
+
+        /// handle_bytes is called by dispatch_bytes with the raw bytes of each transfer.
+        /// Implementations must decode with _decode_state and _transfer_mask.
+        virtual void handle_bytes(const uint8_t* bytes, std::size_t size) = 0;
+
+        /// fifo_occupancy returns the number of elements waiting in the FIFO.
+        /// It is called by dispatch_bytes after each transfer.
+        virtual std::size_t fifo_occupancy() const = 0;
+
+        /// fifo_room returns a number of bytes whose events fit in the FIFO.
+        /// Sources that can wait (such as a replay at full speed) call it before dispatch_bytes.
+        /// By default, any number of bytes is accepted by an empty FIFO, and none by a FIFO in use.
+        virtual std::size_t fifo_room() const {
+            return fifo_occupancy() == 0 ? std::numeric_limits<std::size_t>::max() : 0;
+        }
+
+        /// drained returns true once every element pushed to the FIFO has been handled.
+        virtual bool drained() const {
+            return fifo_occupancy() == 0;
+        }
+
+        /// handle_acquisition_exception is called on the source's thread if the acquisition fails.
+        virtual void handle_acquisition_exception(std::exception_ptr exception) = 0;
+
+        /// fifo_regions returns the memory used by the FIFO, to be moved and locked by the placement policy.
+        virtual std::vector<memory_region> fifo_regions() {
+            return {};
+        }
+
+        /// acquisition_regions returns the memory written by the thread calling dispatch_bytes.
+        /// Sources add their own buffers to the FIFO's regions.
+        virtual std::vector<memory_region> acquisition_regions() {
+            return fifo_regions();
+        }
+
+        /// place_acquisition_thread applies the placement policy from the thread calling dispatch_bytes.
+        /// Memory is moved after the thread is pinned, so that it lands on the thread's node.
+        virtual void place_acquisition_thread() {
+            _placement_report.acquisition_affinity =
+                set_thread_affinity(current_thread(), _placement_policy.acquisition.cpu);
+            _placement_report.acquisition_scheduling = set_thread_scheduling(
+                current_thread(), _placement_policy.acquisition.scheduling, _placement_policy.acquisition.priority);
+            if (_placement_policy.local_memory || _placement_policy.lock_memory) {
+                const auto regions = acquisition_regions();
+                if (_placement_policy.local_memory) {
+                    _placement_report.local_memory = bind_to_current_node(regions);
+                }
+                if (_placement_policy.lock_memory) {
+                    _placement_report.locked_memory = lock_regions(regions);
+                }
+            }
+        }
+
+        /// place_consumer_thread applies the placement policy to the thread calling the handler.
+        virtual void place_consumer_thread(std::thread::native_handle_type thread) {
+            _placement_report.consumer_affinity = set_thread_affinity(thread, _placement_policy.consumer.cpu);
+            _placement_report.consumer_scheduling = set_thread_scheduling(
+                thread, _placement_policy.consumer.scheduling, _placement_policy.consumer.priority);
+        }
+
+        decode_state _decode_state;
+        std::shared_ptr<const pixel_mask> _mask;
+        std::shared_ptr<const pixel_mask> _transfer_mask;
+        telemetry _telemetry;
+        std::unique_ptr<raw_recorder> _raw_recorder;
+        std::atomic<uint64_t> _latest_t;
+        clock_correlator _clock;
+        const placement_policy _placement_policy;
+        placement_report _placement_report;
+    };
+
+    /// usb_camera feeds a byte_sink with the transfers of a CCam ATIS.
+    /// It opens and configures the device, runs the acquisition thread, and opens the device again after
+    /// a disconnection if requested. The raw file is opened by byte_sink before the device,
+    /// so that a failure does not leave the device streaming.
+    class usb_camera : public byte_sink {
+        protected:
+        usb_camera(
+            std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter,
+            uint16_t serial,
+            std::chrono::milliseconds transfer_timeout,
+            std::size_t transfer_size,
+            std::size_t transfer_count,
+            const std::string& raw_filename,
+            std::shared_ptr<const pixel_mask> mask,
+            reconnect_policy reconnection,
+            placement_policy placement,
+            libusb_context* context,
+            device_registry* registry) :
+            byte_sink(raw_filename, std::move(mask), placement),
+            _parameter(default_parameter()),
+            _serial(serial),
+            _acquisition_running(false),
+            _transfer_timeout(transfer_timeout),
+            _transfer_size(transfer_size),
+            _context(context),
+            _owns_context(context == nullptr),
+            _registry(registry),
+            _handle(nullptr),
+            _active_transfers(0),
+            _sent_bias_changes(0),
+            _timestamped_bias_changes(0),
+            _reconnect_policy(reconnection) {
+            if (_transfer_size == 0 || _transfer_size % 4 != 0) {
+                throw std::logic_error("the transfer size must be a non-zero multiple of 4");
+            }
+            _parameter->parse_or_load(std::move(unvalidated_parameter));
+
+            // initialize the context, unless it is shared
+            auto time_point = std::chrono::steady_clock::now();
+            if (_owns_context) {
+                check_usb_error(libusb_init(&_context), "initializing the USB context");
+            }
+            _bring_up.initialization = elapsed_since(time_point);
+            time_point = std::chrono::steady_clock::now();
+
+            try {
+                // resolve serials with the given registry, or with one built on the camera's context
+                if (_registry == nullptr) {
+                    _owned_registry = sepia::make_unique<device_registry>(_context);
+                    _registry = _owned_registry.get();
+                }
+
+                // find the requested device (or the first available device if serial is 0)
+                if (!open_device(serial)) {
+                    throw sepia::no_device_connected("CCam ATIS");
+                }
+                if (_serial == 0 && _reconnect_policy.enabled) {
+                    // remember the serial, so that the same camera is opened after a disconnection
+                    if (device_registry::read_serial(_handle, _serial)) {
+                        _serial = device_registry::swap_serial(_serial);
+                    }
+                }
+                _bring_up.enumeration = elapsed_since(time_point);
+
+                // allocate the transfers (none in synchronous mode)
+                for (std::size_t index = 0; index < transfer_count; ++index) {
+                    _buffers.emplace_back(_transfer_size);
+                    _transfers.push_back(libusb_alloc_transfer(0));
+                    if (_transfers.back() == nullptr) {
+                        _transfers.pop_back();
+                        throw std::bad_alloc();
+                    }
+                }
+
+                // send setup commands to the camera
+                _biases = bias_packet(*_parameter);
+                set_up(_bring_up);
+                _first_start_time_point = _start_time_point;
+            } catch (...) {
+                // the destructor does not run if the constructor throws
+                close_device();
+                for (auto transfer : _transfers) {
+                    libusb_free_transfer(transfer);
+                }
+                if (_owns_context) {
+                    libusb_exit(_context);
+                }
+                throw;
+            }
+        }
+
+        public:
+        usb_camera(const usb_camera&) = delete;
+        usb_camera(usb_camera&&) = default;
+        usb_camera& operator=(const usb_camera&) = delete;
+        usb_camera& operator=(usb_camera&&) = default;
+        virtual ~usb_camera() {
+            stop();
+            close_device();
+            for (auto transfer : _transfers) {
+                libusb_free_transfer(transfer);
+            }
+            if (_owns_context) {
+                libusb_exit(_context);
+            }
+        }
+        /// trigger does nothing: the CCam ATIS commands used by this library do not include a software trigger.
+        virtual void trigger() override {}
+
+        /// bring_up returns the time spent on each step of the device's bring-up.
+        virtual bring_up_timings bring_up() const {
+            return _bring_up;
+        }
+
+        /// set_biases updates the biases while the acquisition is running, and can be called from any thread.
+        /// The update is loaded on top of the current parameter, and the full bias packet is sent.
+        /// The returned change's applied_t is not known yet, and is filled in the log returned by bias_changes.
+        virtual bias_change set_biases(std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter) {
+            std::lock_guard<std::mutex> lock(_bias_mutex);
+            if (_handle == nullptr) {
+                throw sepia::device_disconnected("CCam ATIS");
+            }
+            auto parameter = _parameter->clone();
+            parameter->parse_or_load(std::move(unvalidated_parameter));
+            auto biases = bias_packet(*parameter);
+            bias_change change;
+            change.t = _latest_t.load(std::memory_order_relaxed);
+            change.applied_t = std::numeric_limits<uint64_t>::max();
+            change.converters = 0;
+            for (std::size_t index = 0; index < biases.size(); index += 12) {
+                if (!std::equal(biases.begin() + index, biases.begin() + index + 12, _biases.begin() + index)) {
+                    ++change.converters;
+                }
+            }
+            load_biases(biases.data(), biases.size());
+            _biases = biases;
+            _parameter = std::move(parameter);
+            {
+                std::lock_guard<std::mutex> bias_change_lock(_bias_change_mutex);
+                _bias_changes.push_back(change);
+            }
+            // transfers dispatched from now on completed after the update was sent
+            _sent_bias_changes.fetch_add(1, std::memory_order_release);
+            return change;
+        }
+
+        /// bias_changes returns the updates sent by set_biases, in order.
+        /// It can be called from any thread.
+        virtual std::vector<bias_change> bias_changes() const {
+            std::lock_guard<std::mutex> lock(_bias_change_mutex);
+            return _bias_changes;
+        }
+
+        /// gaps returns the interruptions of the event stream caused by reconnections, in order.
+        /// It can be called from any thread.
+        virtual std::vector<gap> gaps() const {
+            std::lock_guard<std::mutex> lock(_gap_mutex);
+            return _gaps;
+        }
+
+        protected:
+        /// open_device opens and claims the camera with the given serial, or the first available camera if serial is 0.
+        /// A requested serial is resolved by the registry, so that other devices are not opened.
+        /// It returns false if no such camera is available.
+        bool open_device(uint16_t serial) {
+            auto device_found = false;
+            device_location location;
+            if (serial == 0 || _registry->find(device_registry::swap_serial(serial), location)) {
+                libusb_device** devices;
+                const auto count = libusb_get_device_list(_context, &devices);
+                for (ssize_t index = 0; index < count; ++index) {
+                    if (serial == 0) {
+                        libusb_device_descriptor descriptor;
+                        if (libusb_get_device_descriptor(devices[index], &descriptor) != 0
+                            || descriptor.idVendor != 1204 || descriptor.idProduct != 244) {
+                            continue;
+                        }
+                    } else if (!(locate(devices[index]) == location)) {
+                        continue;
+                    }
+                    if (libusb_open(devices[index], &_handle) != 0) {
+                        libusb_free_device_list(devices, 1);
+                        _handle = nullptr;
+                        throw std::logic_error("opening the device failed");
+                    }
+                    if (libusb_claim_interface(_handle, 0) == 0) {
+                        device_found = true;
+                        break;
+                    }
+                    libusb_close(_handle);
+                    _handle = nullptr;
+                    if (serial != 0) {
+                        break;
+                    }
+                }
+                libusb_free_device_list(devices, 1);
+            }
+            return device_found;
+        }
+
+        /// close_device releases and closes the camera, if it is open.
+        void close_device() {
+            if (_handle != nullptr) {
+                libusb_release_interface(_handle, 0);
+                libusb_close(_handle);
+                _handle = nullptr;
+            }
+        }
+
+        /// set_up resets the camera, loads _biases and starts the stream, and records the steps' durations.
+        void set_up(bring_up_timings& timings) {
+            auto time_point = std::chrono::steady_clock::now();
+            check_usb_error(libusb_reset_device(_handle), "resetting the device");
+            timings.reset = elapsed_since(time_point);
+            time_point = std::chrono::steady_clock::now();
+            send_command(_handle, 0x01a, {0, 0, 0x00, 0x01}, "setting the role");
+            send_command(_handle, 0x41a, {0, 0, 0x00, 0x02}, "setting the role");
+            load_biases(_biases.data(), _biases.size());
+            send_command(_handle, 0x008, {0, 0, 0x03, 0x2c}, "set the mode");
+            send_command(_handle, 0x408, {0, 0, 0x03, 0x2c}, "set the mode");
+            timings.configuration = elapsed_since(time_point);
+            time_point = std::chrono::steady_clock::now();
+            {
+                // read stale data until the device's buffer is empty
+                auto data = std::array<uint8_t, 1024>{};
+                for (;;) {
+                    int32_t transferred = 0;
+                    const auto error = libusb_bulk_transfer(
+                        _handle, 129, data.data(), static_cast<int32_t>(data.size()), &transferred, 10);
+                    if (error != 0 || transferred < static_cast<int32_t>(data.size())) {
+                        break;
+                    }
+                }
+            }
+            timings.drain = elapsed_since(time_point);
+            time_point = std::chrono::steady_clock::now();
+            send_command(_handle, 0x000, {0, 0, 0x0c, 0x81}, "start reading");
+            send_command(_handle, 0x400, {0, 0, 0x0c, 0x81}, "start reading");
+            _start_time_point = std::chrono::steady_clock::now();
+            timings.start = std::chrono::duration_cast<std::chrono::microseconds>(_start_time_point - time_point);
+        }
+
+        /// reconnect opens the camera again after a disconnection, and records the resulting gap.
+        /// It retries until the camera is back, the acquisition is stopped or the policy's attempts are exhausted.
+        /// The camera's clock restarts from zero, hence the decoder's base is moved past the gap.
+        virtual void reconnect() {
+            const auto disconnection_time_point = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(_bias_mutex);
+                close_device();
+            }
+            for (std::size_t attempt = 0;; ++attempt) {
+                if (_reconnect_policy.maximum_attempts > 0 && attempt >= _reconnect_policy.maximum_attempts) {
+                    throw sepia::device_disconnected("CCam ATIS");
+                }
+                std::this_thread::sleep_for(_reconnect_policy.retry_interval);
+                if (!_acquisition_running.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(_bias_mutex);
+                try {
+                    if (open_device(_serial)) {
+                        bring_up_timings timings;
+                        set_up(timings);
+                        break;
+                    }
+                } catch (const std::exception&) {
+                    close_device();
+                }
+            }
+            const auto duration = _start_time_point - disconnection_time_point;
+            const auto acquisition_duration = disconnection_time_point - _first_start_time_point;
+            gap new_gap;
+            new_gap.begin = _latest_t.load(std::memory_order_relaxed);
+            new_gap.end = new_gap.begin
+                          + static_cast<uint64_t>(
+                              std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+            new_gap.lost_events = 0;
+            if (acquisition_duration.count() > 0) {
+                new_gap.lost_events = static_cast<uint64_t>(
+                    static_cast<double>(_telemetry.snapshot().events)
+                    * (std::chrono::duration<double>(duration).count()
+                       / std::chrono::duration<double>(acquisition_duration).count()));
+            }
+            _decode_state.t_base = new_gap.end;
+            _decode_state.t_offset = new_gap.end;
+            _decode_state.overflow_counter = 0;
+            _decode_state.partial_size = 0;
+            _clock.reset();
+            _latest_t.store(new_gap.end, std::memory_order_release);
+            _telemetry.add_reconnection(duration, static_cast<std::size_t>(new_gap.lost_events));
+            std::lock_guard<std::mutex> lock(_gap_mutex);
+            _gaps.push_back(new_gap);
+        }
+
+        /// is_disconnection returns true if the given exception is a sepia::device_disconnected.
+        static bool is_disconnection(std::exception_ptr exception) {
+            try {
+                std::rethrow_exception(exception);
+            } catch (const sepia::device_disconnected&) {
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        /// elapsed_since returns the time elapsed since the given time point.
+        static std::chrono::microseconds elapsed_since(std::chrono::steady_clock::time_point time_point) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - time_point);
+        }
+
+        /// load_biases sends a bias packet (a sequence of 12-byte converter entries) and flushes it.
+        virtual void load_biases(uint8_t* packet, std::size_t size) {
+            check_usb_error(
+                libusb_control_transfer(_handle, 64, 97, 0, 0, packet, static_cast<uint16_t>(size), 0),
+                "loading the biases");
+            check_usb_error(
+                libusb_control_transfer(_handle, 64, 98, 0, 0, packet, static_cast<uint16_t>(size), 0),
+                "loading the biases");
+            send_command(_handle, 0x00a, {0, 0, 0x00, 0x40}, "flush the biases");
+            send_command(_handle, 0x40a, {0, 0, 0x00, 0x40}, "flush the biases");
+        }
+
+        /// dispatch_bytes timestamps the bias changes sent before the transfer completed.
+        virtual void dispatch_bytes(const uint8_t* bytes, std::size_t size, bool timed_out) override {
+            const auto sent_bias_changes = _sent_bias_changes.load(std::memory_order_acquire);
+            byte_sink::dispatch_bytes(bytes, size, timed_out);
+            if (sent_bias_changes > _timestamped_bias_changes) {
+                std::lock_guard<std::mutex> lock(_bias_change_mutex);
+                for (; _timestamped_bias_changes < sent_bias_changes; ++_timestamped_bias_changes) {
+                    _bias_changes[_timestamped_bias_changes].applied_t = _latest_t.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// acquisition_regions adds the transfers' buffers to the FIFO's regions.
+        virtual std::vector<memory_region> acquisition_regions() override {
+            auto regions = fifo_regions();
+            for (auto& buffer : _buffers) {
+                regions.emplace_back(buffer.data(), buffer.size());
+            }
+            return regions;
+        }
+
+        /// start launches the acquisition thread, and returns once the thread has been placed.
+        virtual void start() override {
+            _acquisition_running.store(true, std::memory_order_relaxed);
+            std::promise<void> placed;
+            auto placed_future = placed.get_future();
+            _acquisition_loop = std::thread([this, &placed]() -> void {
+                place_acquisition_thread();
+                placed.set_value();
+                try {
+                    if (_transfers.empty()) {
+                        auto data = std::vector<uint8_t>(_transfer_size);
+                        while (_acquisition_running.load(std::memory_order_relaxed)) {
+                            int32_t transferred = 0;
+                            const auto error = libusb_bulk_transfer(
+                                _handle,
+                                129,
+                                data.data(),
+                                static_cast<int32_t>(data.size()),
+                                &transferred,
+                                static_cast<uint32_t>(_transfer_timeout.count()));
+                            if (error == 0 || error == LIBUSB_ERROR_TIMEOUT) {
+                                dispatch_bytes(
+                                    data.data(),
+                                    static_cast<std::size_t>(transferred),
+                                    error == LIBUSB_ERROR_TIMEOUT);
+                            } else if (error == LIBUSB_ERROR_OVERFLOW) {
+                                _telemetry.add_dropped_transfer();
+                            } else if (_reconnect_policy.enabled) {
+                                reconnect();
+                            } else {
+                                throw sepia::device_disconnected("CCam ATIS");
+                            }
+                        }
+                    } else {
+                        timeval timeout;
+                        timeout.tv_sec = static_cast<decltype(timeout.tv_sec)>(_transfer_timeout.count() / 1000);
+                        timeout.tv_usec =
+                            static_cast<decltype(timeout.tv_usec)>((_transfer_timeout.count() % 1000) * 1000);
+                        for (;;) {
+                            submit_transfers();
+                            auto cancelled = false;
+                            while (_active_transfers > 0) {
+                                if (!cancelled
+                                    && (!_acquisition_running.load(std::memory_order_relaxed)
+                                        || _transfer_exception)) {
+                                    cancel_transfers();
+                                    cancelled = true;
+                                }
+                                auto remaining_timeout = timeout;
+                                libusb_handle_events_timeout_completed(_context, &remaining_timeout, nullptr);
+                            }
+                            if (!_transfer_exception) {
+                                break;
+                            }
+                            if (!_reconnect_policy.enabled || !is_disconnection(_transfer_exception)) {
+                                std::rethrow_exception(_transfer_exception);
+                            }
+                            _transfer_exception = std::exception_ptr();
+                            reconnect();
+                            if (!_acquisition_running.load(std::memory_order_relaxed)) {
+                                break;
+                            }
+                        }
+                    }
+                } catch (...) {
+                    handle_acquisition_exception(std::current_exception());
+                }
+            });
+            placed_future.wait();
+        }
+
+        /// stop terminates the acquisition thread, and must be called before the derived object is destroyed.
+        virtual void stop() override {
+            _acquisition_running.store(false, std::memory_order_relaxed);
+            if (_acquisition_loop.joinable()) {
+                _acquisition_loop.join();
+            }
+        }
+
+        /// submit_transfers fills and submits the asynchronous transfers.
+        /// The transfers have no timeout (0), hence they only complete once full, on error or when cancelled.
+        /// The event loop's timeout (transfer_timeout) still bounds the time taken to notice a stop request.
+        /// If a submission fails, _transfer_exception is set and the remaining transfers are not submitted.
+        virtual void submit_transfers() {
+            for (std::size_t index = 0; index < _transfers.size(); ++index) {
+                libusb_fill_bulk_transfer(
+                    _transfers[index],
+                    _handle,
+                    129,
+                    _buffers[index].data(),
+                    static_cast<int32_t>(_buffers[index].size()),
+                    &usb_camera::handle_transfer,
+                    this,
+                    0);
+                if (libusb_submit_transfer(_transfers[index]) < 0) {
+                    _transfer_exception = std::make_exception_ptr(sepia::device_disconnected("CCam ATIS"));
+                    break;
+                }
+                ++_active_transfers;
+            }
+        }
+
+        /// cancel_transfers cancels the pending asynchronous transfers.
+        /// The transfers are not released until libusb has reported their cancellation.
+        virtual void cancel_transfers() {
+            for (auto transfer : _transfers) {
+                libusb_cancel_transfer(transfer);
+            }
+        }
+
+        /// handle_transfer is called by libusb when an asynchronous transfer completes.
+        static void LIBUSB_CALL handle_transfer(libusb_transfer* transfer) {
+            static_cast<usb_camera*>(transfer->user_data)->complete_transfer(transfer);
+        }
+
+        /// complete_transfer decodes a completed transfer and resubmits it while the acquisition is running.
+        /// It runs on the acquisition thread, from within libusb's event handling.
+        virtual void complete_transfer(libusb_transfer* transfer) {
+            switch (transfer->status) {
+                case LIBUSB_TRANSFER_COMPLETED:
+                case LIBUSB_TRANSFER_TIMED_OUT:
+                    if (!_transfer_exception) {
+                        try {
+                            dispatch_bytes(
+                                transfer->buffer,
+                                static_cast<std::size_t>(transfer->actual_length),
+                                transfer->status == LIBUSB_TRANSFER_TIMED_OUT);
+                        } catch (...) {
+                            _transfer_exception = std::current_exception();
+                        }
+                    }
+                    break;
+                case LIBUSB_TRANSFER_OVERFLOW:
+                    _telemetry.add_dropped_transfer();
+                    break;
+                case LIBUSB_TRANSFER_CANCELLED:
+                    _telemetry.add_cancelled_transfer();
+                    break;
+                default:
+                    if (!_transfer_exception) {
+                        _transfer_exception = std::make_exception_ptr(sepia::device_disconnected("CCam ATIS"));
+                    }
+                    break;
+            }
+            if (transfer->status != LIBUSB_TRANSFER_CANCELLED && !_transfer_exception
+                && _acquisition_running.load(std::memory_order_relaxed)) {
+                if (libusb_submit_transfer(transfer) == 0) {
+                    return;
+                }
+                _transfer_exception = std::make_exception_ptr(sepia::device_disconnected("CCam ATIS"));
+            }
+            --_active_transfers;
+        }
+
+        std::unique_ptr<sepia::parameter> _parameter;
+        uint16_t _serial;
+        std::atomic_bool _acquisition_running;
+        const std::chrono::milliseconds _transfer_timeout;
+        const std::size_t _transfer_size;
+        libusb_context* _context;
+        const bool _owns_context;
+        device_registry* _registry;
+        std::unique_ptr<device_registry> _owned_registry;
+        libusb_device_handle* _handle;
+        std::vector<std::vector<uint8_t>> _buffers;
+        std::vector<libusb_transfer*> _transfers;
+        std::size_t _active_transfers;
+        std::exception_ptr _transfer_exception;
+        bring_up_timings _bring_up;
+        std::array<uint8_t, 29 * 12> _biases;
+        std::mutex _bias_mutex;
+        mutable std::mutex _bias_change_mutex;
+        std::vector<bias_change> _bias_changes;
+        std::atomic<std::size_t> _sent_bias_changes;
+        std::size_t _timestamped_bias_changes;
+        std::chrono::steady_clock::time_point _start_time_point;
+        std::chrono::steady_clock::time_point _first_start_time_point;
+        const reconnect_policy _reconnect_policy;
+        mutable std::mutex _gap_mutex;
+        std::vector<gap> _gaps;
+        std::thread _acquisition_loop;
+    };
+
+    /// replay_source reads the raw file written by raw_recorder, and passes its chunks to dispatch_bytes.
+    /// The chunks go through the same decoder, mask and delivery as a live camera's transfers.
+    /// speed_up sets the pace of the replay, computed from the chunks' host timestamps.
+    /// 1 replays in real time, N replays N times faster and 0 replays as fast as possible.
+    /// A paced replay applies the delivery's overflow policy, like a live camera.
+    /// A replay at full speed waits for room in the FIFO instead, polling every poll_duration,
+    /// and dispatches the chunks that do not fit in slices (each slice is counted as a transfer).
+    /// handle_acquisition_exception is called with sepia::end_of_file once the FIFO has been drained.
+    class replay_source : public byte_sink {
+        protected:
+        replay_source(
+            const std::string& filename,
+            double speed_up,
+            std::chrono::milliseconds poll_duration,
+            std::shared_ptr<const pixel_mask> mask,
+            placement_policy placement) :
+            byte_sink(std::string(), std::move(mask), placement),
+            _file(filename),
+            _speed_up(speed_up),
+            _poll_duration(poll_duration),
+            _replay_running(false) {
+            const auto file_signature = raw_recorder::signature();
+            if (_file.size() < file_signature.size()
+                || !std::equal(file_signature.begin(), file_signature.end(), _file.data())) {
+                throw std::runtime_error("the file '" + filename + "' is not a CCam ATIS raw file");
+            }
+        }
+
+        public:
+        replay_source(const replay_source&) = delete;
+        replay_source(replay_source&&) = delete;
+        replay_source& operator=(const replay_source&) = delete;
+        replay_source& operator=(replay_source&&) = delete;
+        virtual ~replay_source() {}
+
+        protected:
+        /// start launches the replay thread, and returns once the thread has been placed.
+        virtual void start() override {
+            _replay_running.store(true, std::memory_order_relaxed);
+            std::promise<void> placed;
+            auto placed_future = placed.get_future();
+            _replay_loop = std::thread([this, &placed]() -> void {
+                place_acquisition_thread();
+                placed.set_value();
+                try {
+                    auto chunk = _file.data() + raw_recorder::signature().size();
+                    const auto end = _file.data() + _file.size();
+                    auto first_timestamp = std::numeric_limits<uint64_t>::max();
+                    const auto begin = std::chrono::steady_clock::now();
+                    while (_replay_running.load(std::memory_order_relaxed)
+                           && static_cast<std::size_t>(end - chunk) >= raw_recorder::chunk_header_size()) {
+                        uint64_t timestamp = 0;
+                        for (std::size_t index = 0; index < 8; ++index) {
+                            timestamp |= static_cast<uint64_t>(chunk[index]) << (8 * index);
                         }
-                        libusb_close(handle);
+                        uint32_t length = 0;
+                        for (std::size_t index = 0; index < 4; ++index) {
+                            length |= static_cast<uint32_t>(chunk[8 + index]) << (8 * index);
+                        }
+                        const auto bytes = chunk + raw_recorder::chunk_header_size();
+                        if (static_cast<std::size_t>(end - bytes) < length) {
+                            break;
+                        }
+                        if (_speed_up > 0) {
+                            if (first_timestamp == std::numeric_limits<uint64_t>::max()) {
+                                first_timestamp = timestamp;
+                            }
+                            if (timestamp > first_timestamp) {
+                                std::this_thread::sleep_until(
+                                    begin
+                                    + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                        std::chrono::duration<double, std::nano>(
+                                            static_cast<double>(timestamp - first_timestamp) / _speed_up)));
+                            }
+                            dispatch_bytes(bytes, length, false);
+                        } else {
+                            std::size_t offset = 0;
+                            do {
+                                auto room = fifo_room();
+                                while (room == 0 && _replay_running.load(std::memory_order_relaxed)) {
+                                    std::this_thread::sleep_for(_poll_duration);
+                                    room = fifo_room();
+                                }
+                                const auto size = std::min(room, length - offset);
+                                dispatch_bytes(bytes + offset, size, false);
+                                offset += size;
+                            } while (offset < length && _replay_running.load(std::memory_order_relaxed));
+                        }
+                        chunk = bytes + length;
                     }
+                    while (_replay_running.load(std::memory_order_relaxed) && !drained()) {
+                        std::this_thread::sleep_for(_poll_duration);
+                    }
+                    if (_replay_running.load(std::memory_order_relaxed)) {
+                        throw sepia::end_of_file();
+                    }
+                } catch (...) {
+                    handle_acquisition_exception(std::current_exception());
                 }
+            });
+            placed_future.wait();
+        }
+
+        /// stop terminates the replay thread, and must be called before the derived object is destroyed.
+        virtual void stop() override {
+            _replay_running.store(false, std::memory_order_relaxed);
+            if (_replay_loop.joinable()) {
+                _replay_loop.join();
             }
-            libusb_free_device_list(devices, 1);
-            libusb_exit(context);
-            return serials;
         }
 
-        /// default_parameter returns the default parameter used by the CCam ATIS.
-        static std::unique_ptr<sepia::parameter> default_parameter() {
-            return sepia::make_unique<sepia::object_parameter>(
-                "change_detection",
-                sepia::make_unique<sepia::object_parameter>(
-                    "reset_switch_bulk_potential",
-                    sepia::make_unique<sepia::char_parameter>(207),
-                    "photoreceptor_feedback",
-                    sepia::make_unique<sepia::char_parameter>(243),
-                    "refractory_period",
-                    sepia::make_unique<sepia::char_parameter>(216),
-                    "follower",
-                    sepia::make_unique<sepia::char_parameter>(239),
-                    "event_source_amplifier",
-                    sepia::make_unique<sepia::char_parameter>(42),
-                    "on_event_threshold",
-                    sepia::make_unique<sepia::char_parameter>(51),
-                    "off_event_threshold",
-                    sepia::make_unique<sepia::char_parameter>(39),
-                    "off_event_inverter",
-                    sepia::make_unique<sepia::char_parameter>(61),
-                    "cascode_photoreceptor_feedback",
-                    sepia::make_unique<sepia::char_parameter>(154)),
-                "exposure_measurement",
-                sepia::make_unique<sepia::object_parameter>(
-                    "comparator_tail",
-                    sepia::make_unique<sepia::char_parameter>(54),
-                    "comparator_hysteresis",
-                    sepia::make_unique<sepia::char_parameter>(47),
-                    "comparator_output_stage",
-                    sepia::make_unique<sepia::char_parameter>(57),
-                    "upper_threshold",
-                    sepia::make_unique<sepia::char_parameter>(243),
-                    "lower_threshold",
-                    sepia::make_unique<sepia::char_parameter>(235)),
-                "pullup",
-                sepia::make_unique<sepia::object_parameter>(
-                    "exposure_measurement_abscissa_request",
-                    sepia::make_unique<sepia::char_parameter>(131),
-                    "exposure_measurement_ordinate_request",
-                    sepia::make_unique<sepia::char_parameter>(155),
-                    "change_detection_abscissa_request",
-                    sepia::make_unique<sepia::char_parameter>(151),
-                    "change_detection_ordinate_request",
-                    sepia::make_unique<sepia::char_parameter>(117),
-                    "abscissa_acknoledge",
-                    sepia::make_unique<sepia::char_parameter>(162),
-                    "abscissa_encoder",
-                    sepia::make_unique<sepia::char_parameter>(162),
-                    "ordinate_encoder",
-                    sepia::make_unique<sepia::char_parameter>(120)),
-                "control",
-                sepia::make_unique<sepia::object_parameter>(
-                    "exposure_measurement_timeout",
-                    sepia::make_unique<sepia::char_parameter>(49),
-                    "sequential_exposure_measurement_timeout",
-                    sepia::make_unique<sepia::char_parameter>(45),
-                    "abscissa_acknoledge_timeout",
-                    sepia::make_unique<sepia::char_parameter>(56),
-                    "latch_cell_scan_pulldown",
-                    sepia::make_unique<sepia::char_parameter>(134),
-                    "abscissa_request_pulldown",
-                    sepia::make_unique<sepia::char_parameter>(87)));
+        memory_mapped_file _file;
+        const double _speed_up;
+        const std::chrono::milliseconds _poll_duration;
+        std::atomic_bool _replay_running;
+        std::thread _replay_loop;
+    };
+
+    /// fifo_counters holds the consumer's side of an event FIFO, shared with the producer.
+    struct fifo_counters {
+        fifo_counters() : pulled_events(0), handled_events(0), skip_until(0), skipped_events(0) {}
+
+        /// pulled_events is the number of events read from the FIFO.
+        std::atomic<uint64_t> pulled_events;
+
+        /// handled_events is the number of events read from the FIFO and either handled or skipped.
+        std::atomic<uint64_t> handled_events;
+
+        /// skip_until is the index (in pulled events) of the last event to skip, set by the producer.
+        std::atomic<uint64_t> skip_until;
+
+        /// skipped_events is the number of events read from the FIFO and not passed to the handler.
+        std::atomic<uint64_t> skipped_events;
+    };
+
+    /// counting_handler wraps the event handler called by sepia's consumer thread.
+    /// It counts the events pulled from sepia's FIFO, so that the producer can measure the FIFO occupancy,
+    /// and skips the events up to skip_until, so that the producer can drop the oldest events.
+    template <typename HandleEvent>
+    class counting_handler {
+        public:
+        counting_handler(HandleEvent handle_event) :
+            _handle_event(std::forward<HandleEvent>(handle_event)),
+            _counters(sepia::make_unique<fifo_counters>()) {}
+        counting_handler(const counting_handler&) = delete;
+        counting_handler(counting_handler&&) = default;
+        counting_handler& operator=(const counting_handler&) = delete;
+        counting_handler& operator=(counting_handler&&) = default;
+        virtual ~counting_handler() {}
+
+        /// operator() is called by sepia's consumer thread with each event pulled from the FIFO.
+        void operator()(sepia::atis_event event) {
+            const auto pulled_events = _counters->pulled_events.load(std::memory_order_relaxed) + 1;
+            _counters->pulled_events.store(pulled_events, std::memory_order_release);
+            if (pulled_events > _counters->skip_until.load(std::memory_order_acquire)) {
+                _handle_event(event);
+            } else {
+                _counters->skipped_events.store(
+                    _counters->skipped_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            _counters->handled_events.store(pulled_events, std::memory_order_release);
+        }
+
+        /// counters returns the counters shared with the producer.
+        fifo_counters& counters() const {
+            return *_counters;
+        }
+
+        protected:
+        HandleEvent _handle_event;
+        std::unique_ptr<fifo_counters> _counters;
+    };
+
+    /// event_delivery passes the events decoded by its source to handle_event through sepia's camera,
+    /// which owns the FIFO and the consumer thread.
+    /// Source is usb_camera for a live camera, replay_source for a raw file, or byte_sink (see byte_sink).
+    /// The source's arguments follow the delivery's arguments.
+    template <typename Source, typename HandleEvent, typename HandleException>
+    class event_delivery
+        : public Source,
+          public sepia::specialized_camera<sepia::atis_event, counting_handler<HandleEvent>, HandleException> {
+        public:
+        template <typename... SourceArguments>
+        event_delivery<Source, HandleEvent, HandleException>(
+            HandleEvent handle_event,
+            HandleException handle_exception,
+            std::size_t fifo_size,
+            std::chrono::milliseconds sleep_duration,
+            overflow_policy policy,
+            SourceArguments&&... source_arguments) :
+            Source(std::forward<SourceArguments>(source_arguments)...),
+            sepia::specialized_camera<sepia::atis_event, counting_handler<HandleEvent>, HandleException>(
+                counting_handler<HandleEvent>(std::forward<HandleEvent>(handle_event)),
+                std::forward<HandleException>(handle_exception),
+                fifo_size,
+                sleep_duration),
+            _event_shedder(policy, fifo_size),
+            _pushed_events(0) {
+            // sepia's base destructor joins the consumer thread if start throws
+            this->place_consumer_thread(this->_buffer_loop.native_handle());
+            this->start();
+        }
+        event_delivery(const event_delivery&) = delete;
+        event_delivery(event_delivery&&) = default;
+        event_delivery& operator=(const event_delivery&) = delete;
+        event_delivery& operator=(event_delivery&&) = default;
+        virtual ~event_delivery() {
+            this->stop();
+        }
+        virtual acquisition_statistics statistics() const override {
+            auto statistics = Source::statistics();
+            statistics.shed_events += this->_handle_event.counters().skipped_events.load(std::memory_order_relaxed);
+            return statistics;
+        }
+
+        protected:
+        /// handle_bytes decodes raw bytes from the source and pushes the resulting events to sepia's FIFO.
+        /// The FIFO occupancy is estimated once per transfer, since the consumer can only decrease it.
+        /// The acquisition thread never waits for the consumer: events that do not fit are discarded,
+        /// after making the consumer skip the oldest events in drop_oldest mode.
+        virtual void handle_bytes(const uint8_t* bytes, std::size_t size) override {
+            const auto pulled_events =
+                this->_handle_event.counters().pulled_events.load(std::memory_order_acquire);
+            // the transfer yields at most one event per word, plus one for a partial word
+            auto remaining_events = static_cast<uint64_t>(size / 4 + 1);
+            auto skipping = false;
+            std::size_t shed_events = 0;
+            decode(bytes, size, this->_decode_state, this->_transfer_mask.get(), [&](sepia::atis_event event) {
+                --remaining_events;
+                if (_event_shedder.shed(event, static_cast<std::size_t>(_pushed_events - pulled_events))) {
+                    ++shed_events;
+                } else if (this->push(event)) {
+                    ++_pushed_events;
+                } else {
+                    switch (_event_shedder.policy().mode) {
+                        case overflow_mode::fail:
+                            throw std::runtime_error("computer's FIFO overflow");
+                        case overflow_mode::drop_oldest:
+                            if (!skipping) {
+                                skip_oldest(remaining_events);
+                                skipping = true;
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                    ++shed_events;
+                }
+            });
+            if (shed_events > 0) {
+                this->_telemetry.add_shed_events(shed_events);
+            }
+        }
+
+        /// handle_acquisition_exception forwards acquisition errors to the exception handler.
+        virtual void handle_acquisition_exception(std::exception_ptr exception) override {
+            this->_handle_exception(exception);
+        }
+
+        virtual std::vector<memory_region> fifo_regions() override {
+            return {memory_region(this->_events.data(), this->_events.size() * sizeof(sepia::atis_event))};
+        }
+
+        virtual std::size_t fifo_occupancy() const override {
+            return static_cast<std::size_t>(
+                _pushed_events - this->_handle_event.counters().pulled_events.load(std::memory_order_acquire));
+        }
+
+        /// fifo_room accounts for one event per word, plus one for a partial word.
+        /// sepia's FIFO keeps one slot empty, hence it holds at most fifo_size - 1 events.
+        virtual std::size_t fifo_room() const override {
+            const auto free_slots = this->_events.size() - 1 - fifo_occupancy();
+            return free_slots > 1 ? (free_slots - 1) * 4 : 0;
+        }
+
+        virtual bool drained() const override {
+            return _pushed_events == this->_handle_event.counters().handled_events.load(std::memory_order_acquire);
+        }
+
+        /// skip_oldest makes the consumer skip the oldest waiting events (at most count), to make room for new events.
+        /// The consumer skips them as it pulls them, hence skip_oldest returns immediately.
+        void skip_oldest(uint64_t count) {
+            auto& counters = this->_handle_event.counters();
+            const auto skip_until =
+                std::min(_pushed_events, counters.pulled_events.load(std::memory_order_acquire) + count);
+            if (skip_until > counters.skip_until.load(std::memory_order_relaxed)) {
+                counters.skip_until.store(skip_until, std::memory_order_release);
+            }
+        }
+
+        event_shedder _event_shedder;
+        uint64_t _pushed_events;
+    };
+
+    /// specialized_camera represents a template-specialized CCam ATIS.
+    /// Events are passed to handle_event on a dedicated thread, through a FIFO.
+    template <typename HandleEvent, typename HandleException>
+    class specialized_camera : public event_delivery<usb_camera, HandleEvent, HandleException> {
+        public:
+        specialized_camera<HandleEvent, HandleException>(
+            HandleEvent handle_event,
+            HandleException handle_exception,
+            std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter,
+            std::size_t fifo_size,
+            uint16_t serial,
+            std::chrono::milliseconds sleep_duration,
+            std::size_t transfer_size,
+            std::size_t transfer_count,
+            const std::string& raw_filename,
+            overflow_policy policy,
+            std::shared_ptr<const pixel_mask> mask,
+            reconnect_policy reconnection,
+            placement_policy placement) :
+            event_delivery<usb_camera, HandleEvent, HandleException>(
+                std::forward<HandleEvent>(handle_event),
+                std::forward<HandleException>(handle_exception),
+                fifo_size,
+                sleep_duration,
+                policy,
+                std::move(unvalidated_parameter),
+                serial,
+                sleep_duration,
+                transfer_size,
+                transfer_count,
+                raw_filename,
+                std::move(mask),
+                reconnection,
+                placement,
+                nullptr,
+                nullptr) {}
+        specialized_camera(const specialized_camera&) = delete;
+        specialized_camera(specialized_camera&&) = default;
+        specialized_camera& operator=(const specialized_camera&) = delete;
+        specialized_camera& operator=(specialized_camera&&) = default;
+        virtual ~specialized_camera() {}
+    };
+
+    /// make_camera creates a camera from functors.
+    /// serial selects the camera, and 0 opens the first available camera (see camera::available_serials).
+    /// If transfer_count is zero, the camera reads with blocking transfers.
+    /// Otherwise, transfer_count asynchronous transfers of transfer_size bytes are kept in flight.
+    /// If raw_filename is not empty, the raw bytes are also written to this file (see raw_recorder).
+    /// policy determines the behaviour of the camera when its FIFO fills up (see overflow_mode).
+    /// If mask is not null, events from masked pixels are discarded by the decoder (see byte_sink::set_mask).
+    /// If reconnection is enabled, a disconnected camera is opened again and the stream resumes (see usb_camera::gaps).
+    /// placement pins and prioritises the acquisition and consumer threads, and moves and locks their memory.
+    /// Options the operating system refuses are ignored, and reported by byte_sink::placement.
+    template <typename HandleEvent, typename HandleException>
+    std::unique_ptr<specialized_camera<HandleEvent, HandleException>> make_camera(
+        HandleEvent handle_event,
+        HandleException handle_exception,
+        std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter =
+            std::unique_ptr<sepia::unvalidated_parameter>(),
+        std::size_t fifo_size = 1 << 24,
+        uint16_t serial = 0,
+        std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10),
+        std::size_t transfer_size = 1 << 17,
+        std::size_t transfer_count = 0,
+        const std::string& raw_filename = std::string(),
+        overflow_policy policy = overflow_policy(),
+        std::shared_ptr<const pixel_mask> mask = std::shared_ptr<const pixel_mask>(),
+        reconnect_policy reconnection = reconnect_policy(),
+        placement_policy placement = placement_policy()) {
+        return sepia::make_unique<specialized_camera<HandleEvent, HandleException>>(
+            std::forward<HandleEvent>(handle_event),
+            std::forward<HandleException>(handle_exception),
+            std::move(unvalidated_parameter),
+            fifo_size,
+            serial,
+            sleep_duration,
+            transfer_size,
+            transfer_count,
+            raw_filename,
+            policy,
+            std::move(mask),
+            reconnection,
+            placement);
+    }
+
+    /// buffer_delivery passes the events decoded by its source to handle_buffer in batches, on a dedicated thread.
+    /// Buffers are recycled in a circular FIFO, hence the handler must not keep references to them.
+    /// Each buffer reserves buffer_size events. The source's arguments follow the delivery's arguments.
+    template <typename Source, typename HandleBuffer, typename HandleException>
+    class buffer_delivery : public Source {
+        public:
+        template <typename... SourceArguments>
+        buffer_delivery<Source, HandleBuffer, HandleException>(
+            HandleBuffer handle_buffer,
+            HandleException handle_exception,
+            std::size_t buffer_count,
+            std::size_t buffer_size,
+            std::chrono::milliseconds sleep_duration,
+            uint64_t slice_duration,
+            overflow_policy policy,
+            SourceArguments&&... source_arguments) :
+            Source(std::forward<SourceArguments>(source_arguments)...),
+            _handle_buffer(std::forward<HandleBuffer>(handle_buffer)),
+            _handle_exception(std::forward<HandleException>(handle_exception)),
+            _buffer_running(true),
+            _sleep_duration(sleep_duration),
+            _slice_duration(slice_duration),
+            _slice_end(slice_duration),
+            _event_shedder(policy, buffer_count),
+            _shed_events(0),
+            _head(0),
+            _tail(0),
+            _published_buffers(0),
+            _consumed_buffers(0),
+            _skip_until(0),
+            _skipped_events(0) {
+            if (buffer_count < 2) {
+                throw std::logic_error("the buffer count must be at least 2");
+            }
+            _event_buffers.resize(buffer_count);
+            for (auto& event_buffer : _event_buffers) {
+                event_buffer.reserve(buffer_size);
+            }
+            _buffer_loop = std::thread([this]() -> void {
+                try {
+                    while (_buffer_running.load(std::memory_order_relaxed)) {
+                        const auto current_tail = _tail.load(std::memory_order_relaxed);
+                        if (current_tail == _head.load(std::memory_order_acquire)) {
+                            std::this_thread::sleep_for(_sleep_duration);
+                        } else {
+                            const auto consumed_buffers = _consumed_buffers.load(std::memory_order_relaxed) + 1;
+                            _consumed_buffers.store(consumed_buffers, std::memory_order_release);
+                            if (consumed_buffers > _skip_until.load(std::memory_order_acquire)) {
+                                _handle_buffer(static_cast<const std::vector<sepia::atis_event>&>(
+                                    _event_buffers[current_tail]));
+                            } else {
+                                _skipped_events.store(
+                                    _skipped_events.load(std::memory_order_relaxed)
+                                        + _event_buffers[current_tail].size(),
+                                    std::memory_order_relaxed);
+                            }
+                            _tail.store((current_tail + 1) % _event_buffers.size(), std::memory_order_release);
+                        }
+                    }
+                } catch (...) {
+                    _handle_exception(std::current_exception());
+                }
+            });
+            try {
+                this->place_consumer_thread(_buffer_loop.native_handle());
+                this->start();
+            } catch (...) {
+                // the destructor does not run if the constructor throws, and a joinable thread must not be destroyed
+                _buffer_running.store(false, std::memory_order_relaxed);
+                _buffer_loop.join();
+                throw;
+            }
+        }
+        buffer_delivery(const buffer_delivery&) = delete;
+        buffer_delivery(buffer_delivery&&) = default;
+        buffer_delivery& operator=(const buffer_delivery&) = delete;
+        buffer_delivery& operator=(buffer_delivery&&) = default;
+        virtual ~buffer_delivery() {
+            this->stop();
+            _buffer_running.store(false, std::memory_order_relaxed);
+            _buffer_loop.join();
+        }
+        virtual acquisition_statistics statistics() const override {
+            auto statistics = Source::statistics();
+            statistics.shed_events += _skipped_events.load(std::memory_order_relaxed);
+            return statistics;
         }
 
-        /// width returns the sensor width.
-        static constexpr uint16_t width() {
-            return 304;
+        protected:
+        /// handle_bytes decodes raw bytes from the source into the buffer at the head of the FIFO.
+        /// In transfer mode (zero slice duration), each transfer yields one buffer.
+        /// In slice mode, a buffer is published whenever an event reaches the end of the current slice.
+        /// A buffer is also published early when it reaches its capacity, so that no allocation happens.
+        virtual void handle_bytes(const uint8_t* bytes, std::size_t size) override {
+            auto event_buffer = &_event_buffers[_head.load(std::memory_order_relaxed)];
+            const auto occupancy = fifo_occupancy();
+            _shed_events = 0;
+            decode(bytes, size, this->_decode_state, this->_transfer_mask.get(), [&](sepia::atis_event event) {
+                if (_slice_duration > 0 && event.t >= _slice_end) {
+                    if (!event_buffer->empty()) {
+                        event_buffer = publish_and_next_buffer();
+                    }
+                    _slice_end = (event.t / _slice_duration + 1) * _slice_duration;
+                } else if (event_buffer->size() == event_buffer->capacity()) {
+                    event_buffer = publish_and_next_buffer();
+                }
+                if (_event_shedder.shed(event, occupancy)) {
+                    ++_shed_events;
+                } else {
+                    event_buffer->push_back(event);
+                }
+            });
+            if (_slice_duration == 0 && !event_buffer->empty()) {
+                publish_and_next_buffer();
+            }
+            if (_shed_events > 0) {
+                this->_telemetry.add_shed_events(_shed_events);
+            }
         }
 
-        /// height returns the sensor height.
-        static constexpr uint16_t height() {
-            return 240;
+        /// handle_acquisition_exception forwards acquisition errors to the exception handler.
+        virtual void handle_acquisition_exception(std::exception_ptr exception) override {
+            _handle_exception(exception);
         }
 
-        /// configuration contains the settings for the digital-to-analog converters on the FPGA.
-        static std::
-            unordered_map<std::string, std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>>>
-            configuration() {
-            return {
-                {"change_detection",
-                 {
-                     {"reset_switch_bulk_potential", {{"address", 0x02}, {"tension", 0x5900}}},
-                     {"photoreceptor_feedback", {{"address", 0x03}, {"tension", 0x5900}}},
-                     {"refractory_period", {{"address", 0x04}, {"tension", 0x5900}}},
-                     {"follower", {{"address", 0x05}, {"tension", 0x5900}}},
-                     {"event_source_amplifier", {{"address", 0x06}, {"tension", 0x7900}}},
-                     {"on_event_threshold", {{"address", 0x07}, {"tension", 0x7900}}},
-                     {"off_event_threshold", {{"address", 0x08}, {"tension", 0x7900}}},
-                     {"off_event_inverter", {{"address", 0x09}, {"tension", 0x7900}}},
-                     {"cascode_photoreceptor_feedback", {{"address", 0x0a}, {"tension", 0x7900}}},
-                 }},
-                {"exposure_measurement",
-                 {
-                     {"comparator_tail", {{"address", 0x0b}, {"tension", 0x7900}}},
-                     {"comparator_hysteresis", {{"address", 0x0c}, {"tension", 0x7900}}},
-                     {"comparator_output_stage", {{"address", 0x0d}, {"tension", 0x7900}}},
-                     {"upper_threshold", {{"address", 0x0e}, {"tension", 0x5900}}},
-                     {"lower_threshold", {{"address", 0x0f}, {"tension", 0x5900}}},
-                 }},
-                {"pullup",
-                 {
-                     {"exposure_measurement_abscissa_request", {{"address", 0x10}, {"tension", 0x5900}}},
-                     {"exposure_measurement_ordinate_request", {{"address", 0x11}, {"tension", 0x5900}}},
-                     {"change_detection_abscissa_request", {{"address", 0x12}, {"tension", 0x5900}}},
-                     {"change_detection_ordinate_request", {{"address", 0x13}, {"tension", 0x7900}}},
-                     {"abscissa_acknoledge", {{"address", 0x14}, {"tension", 0x5900}}},
-                     {"abscissa_encoder", {{"address", 0x15}, {"tension", 0x5900}}},
-                     {"ordinate_encoder", {{"address", 0x16}, {"tension", 0x7900}}},
-                 }},
-                {"control",
-                 {
-                     {"exposure_measurement_timeout", {{"address", 0x17}, {"tension", 0x7900}}},
-                     {"sequential_exposure_measurement_timeout", {{"address", 0x18}, {"tension", 0x7900}}},
-                     {"abscissa_acknoledge_timeout", {{"address", 0x19}, {"tension", 0x7900}}},
-                     {"latch_cell_scan_pulldown", {{"address", 0x1a}, {"tension", 0x5900}}},
-                     {"abscissa_request_pulldown", {{"address", 0x1b}, {"tension", 0x7900}}},
-                 }},
-                {"static",
-                 {
-                     {"reset_t", {{"address", 0x00}, {"tension", 0x5900}, {"value", 0}}},
-                     {"test_event", {{"address", 0x01}, {"tension", 0x7900}, {"value", 0}}},
-                     {"reset_photodiodes", {{"address", 0x1c}, {"tension", 0x00}, {"value", 3}}},
-                 }},
-            };
+        virtual std::size_t fifo_occupancy() const override {
+            return (_head.load(std::memory_order_relaxed) + _event_buffers.size()
+                    - _tail.load(std::memory_order_relaxed))
+                   % _event_buffers.size();
         }
 
-        camera() = default;
-        camera(const camera&) = delete;
-        camera(camera&&) = default;
-        camera& operator=(const camera&) = delete;
-        camera& operator=(camera&&) = default;
-        virtual ~camera() {}
+        virtual std::vector<memory_region> fifo_regions() override {
+            std::vector<memory_region> regions;
+            for (auto& event_buffer : _event_buffers) {
+                regions.emplace_back(event_buffer.data(), event_buffer.capacity() * sizeof(sepia::atis_event));
+            }
+            return regions;
+        }
 
-        /// trigger sends a trigger signal to the camera.
-        /// with default settings, this signal will trigger a change detection on every pixel.
-        virtual void trigger() = 0;
+        /// publish_and_next_buffer hands the head buffer to the consumer and returns the next (cleared) buffer.
+        /// The buffer at the head of the FIFO is always owned by the acquisition thread.
+        /// If the FIFO is full, the head buffer is either discarded and returned, or an exception is thrown.
+        /// In drop_oldest mode, the consumer is also told to skip the oldest waiting buffer, to make room for the next
+        /// one. The acquisition thread never waits for the consumer.
+        virtual std::vector<sepia::atis_event>* publish_and_next_buffer() {
+            const auto current_head = _head.load(std::memory_order_relaxed);
+            const auto next_head = (current_head + 1) % _event_buffers.size();
+            if (next_head == _tail.load(std::memory_order_acquire)) {
+                switch (_event_shedder.policy().mode) {
+                    case overflow_mode::fail:
+                        throw std::runtime_error("computer's FIFO overflow");
+                    case overflow_mode::drop_oldest:
+                        skip_oldest();
+                        break;
+                    default:
+                        break;
+                }
+                auto event_buffer = &_event_buffers[current_head];
+                _shed_events += event_buffer->size();
+                event_buffer->clear();
+                return event_buffer;
+            }
+            ++_published_buffers;
+            _head.store(next_head, std::memory_order_release);
+            auto event_buffer = &_event_buffers[next_head];
+            event_buffer->clear();
+            return event_buffer;
+        }
 
-        protected:
-        /// check_usb_error throws if the given value is not zero.
-        static void check_usb_error(int error, const std::string& message) {
-            if (error < 0) {
-                throw std::logic_error(message + " failed: " + libusb_strerror(static_cast<libusb_error>(error)));
+        /// skip_oldest makes the consumer skip the oldest waiting buffer.
+        /// The buffer being handled is already consumed, the next one is the oldest waiting buffer.
+        void skip_oldest() {
+            const auto skip_until = _consumed_buffers.load(std::memory_order_acquire) + 1;
+            if (skip_until > _skip_until.load(std::memory_order_relaxed)) {
+                _skip_until.store(skip_until, std::memory_order_release);
             }
         }
 
-        /// send_command sends a setup command to the given camera.
-        static void send_command(
-            libusb_device_handle* handle,
-            uint16_t w_value,
-            std::array<uint8_t, 4> data,
-            const std::string& message) {
-            check_usb_error(
-                libusb_control_transfer(handle, 64, 86, w_value, 0, data.data(), static_cast<uint16_t>(data.size()), 0),
-                message);
+        HandleBuffer _handle_buffer;
+        HandleException _handle_exception;
+        std::atomic_bool _buffer_running;
+        const std::chrono::milliseconds _sleep_duration;
+        const uint64_t _slice_duration;
+        uint64_t _slice_end;
+        event_shedder _event_shedder;
+        std::size_t _shed_events;
+        std::vector<std::vector<sepia::atis_event>> _event_buffers;
+        std::atomic<std::size_t> _head;
+        std::atomic<std::size_t> _tail;
+        uint64_t _published_buffers;
+        std::atomic<uint64_t> _consumed_buffers;
+        std::atomic<uint64_t> _skip_until;
+        std::atomic<uint64_t> _skipped_events;
+        std::thread _buffer_loop;
+    };
+
+    /// specialized_buffered_camera represents a template-specialized CCam ATIS delivering events in buffers.
+    /// Buffers are recycled in a circular FIFO, hence the handler must not keep references to them.
+    template <typename HandleBuffer, typename HandleException>
+    class specialized_buffered_camera : public buffer_delivery<usb_camera, HandleBuffer, HandleException> {
+        public:
+        specialized_buffered_camera<HandleBuffer, HandleException>(
+            HandleBuffer handle_buffer,
+            HandleException handle_exception,
+            std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter,
+            std::size_t buffer_count,
+            uint16_t serial,
+            std::chrono::milliseconds sleep_duration,
+            uint64_t slice_duration,
+            std::size_t transfer_size,
+            std::size_t transfer_count,
+            const std::string& raw_filename,
+            overflow_policy policy,
+            std::shared_ptr<const pixel_mask> mask,
+            reconnect_policy reconnection,
+            placement_policy placement) :
+            buffer_delivery<usb_camera, HandleBuffer, HandleException>(
+                std::forward<HandleBuffer>(handle_buffer),
+                std::forward<HandleException>(handle_exception),
+                buffer_count,
+                transfer_size / 4,
+                sleep_duration,
+                slice_duration,
+                policy,
+                std::move(unvalidated_parameter),
+                serial,
+                sleep_duration,
+                transfer_size,
+                transfer_count,
+                raw_filename,
+                std::move(mask),
+                reconnection,
+                placement,
+                nullptr,
+                nullptr) {}
+        specialized_buffered_camera(const specialized_buffered_camera&) = delete;
+        specialized_buffered_camera(specialized_buffered_camera&&) = default;
+        specialized_buffered_camera& operator=(const specialized_buffered_camera&) = delete;
+        specialized_buffered_camera& operator=(specialized_buffered_camera&&) = default;
+        virtual ~specialized_buffered_camera() {}
+    };
+
+    /// make_buffered_camera creates a buffered camera from functors.
+    /// handle_buffer is called with a const std::vector<sepia::atis_event>& on a dedicated thread.
+    /// If slice_duration is zero, each transfer yields one buffer.
+    /// Otherwise, buffers span slice_duration microseconds (and are split when they exceed transfer_size / 4 events).
+    /// The overflow policy's occupancy is expressed in buffers, and full buffers are discarded as a whole.
+    /// The mask, reconnection and placement parameters behave as in make_camera.
+    template <typename HandleBuffer, typename HandleException>
+    std::unique_ptr<specialized_buffered_camera<HandleBuffer, HandleException>> make_buffered_camera(
+        HandleBuffer handle_buffer,
+        HandleException handle_exception,
+        std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter =
+            std::unique_ptr<sepia::unvalidated_parameter>(),
+        std::size_t buffer_count = 1 << 8,
+        uint16_t serial = 0,
+        std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10),
+        uint64_t slice_duration = 0,
+        std::size_t transfer_size = 1 << 17,
+        std::size_t transfer_count = 0,
+        const std::string& raw_filename = std::string(),
+        overflow_policy policy = overflow_policy(),
+        std::shared_ptr<const pixel_mask> mask = std::shared_ptr<const pixel_mask>(),
+        reconnect_policy reconnection = reconnect_policy(),
+        placement_policy placement = placement_policy()) {
+        return sepia::make_unique<specialized_buffered_camera<HandleBuffer, HandleException>>(
+            std::forward<HandleBuffer>(handle_buffer),
+            std::forward<HandleException>(handle_exception),
+            std::move(unvalidated_parameter),
+            buffer_count,
+            serial,
+            sleep_duration,
+            slice_duration,
+            transfer_size,
+            transfer_count,
+            raw_filename,
+            policy,
+            std::move(mask),
+            reconnection,
+            placement);
+    }
+
+#if !defined(_WIN32)
+    /// shared_memory_delivery decodes the bytes of its source directly into a shared_ring_writer,
+    /// which other processes read with shared_ring_reader. Readers never slow the acquisition down,
+    /// and detect the events they missed. transfer_size is the largest number of bytes passed at once.
+    /// The source's arguments follow the delivery's arguments.
+    template <typename Source, typename HandleException>
+    class shared_memory_delivery : public Source {
+        public:
+        template <typename... SourceArguments>
+        shared_memory_delivery<Source, HandleException>(
+            HandleException handle_exception,
+            const std::string& name,
+            std::size_t capacity,
+            std::size_t transfer_size,
+            SourceArguments&&... source_arguments) :
+            Source(std::forward<SourceArguments>(source_arguments)...),
+            _handle_exception(std::forward<HandleException>(handle_exception)),
+            _ring(name, capacity) {
+            if (capacity < transfer_size / 2) {
+                throw std::logic_error("the ring capacity must be at least twice the number of words in a transfer");
+            }
+            this->start();
+        }
+        shared_memory_delivery(const shared_memory_delivery&) = delete;
+        shared_memory_delivery(shared_memory_delivery&&) = delete;
+        shared_memory_delivery& operator=(const shared_memory_delivery&) = delete;
+        shared_memory_delivery& operator=(shared_memory_delivery&&) = delete;
+        virtual ~shared_memory_delivery() {
+            this->stop();
+        }
+
+        protected:
+        /// handle_bytes decodes raw bytes from the source into the ring, and publishes them once per transfer.
+        virtual void handle_bytes(const uint8_t* bytes, std::size_t size) override {
+            _ring.reserve(size / 4 + 1);
+            decode(bytes, size, this->_decode_state, this->_transfer_mask.get(), [&](sepia::atis_event event) {
+                _ring.push(event);
+            });
+            _ring.publish();
+        }
+
+        /// fifo_occupancy is always zero, since the ring overwrites the events that readers missed.
+        virtual std::size_t fifo_occupancy() const override {
+            return 0;
+        }
+
+        /// handle_acquisition_exception forwards acquisition errors to the exception handler.
+        virtual void handle_acquisition_exception(std::exception_ptr exception) override {
+            _handle_exception(exception);
         }
+
+        HandleException _handle_exception;
+        shared_ring_writer _ring;
     };
 
-    /// specialized_camera represents a template-specialized CCam ATIS.
-    template <typename HandleEvent, typename HandleException>
-    class specialized_camera : public camera,
-                               public sepia::specialized_camera<sepia::atis_event, HandleEvent, HandleException> {
+    /// specialized_shared_memory_camera represents a template-specialized CCam ATIS publishing to shared memory.
+    /// Events are decoded directly into a shared_ring_writer, which other processes read with shared_ring_reader.
+    /// Readers never slow the acquisition down, and detect the events they missed.
+    template <typename HandleException>
+    class specialized_shared_memory_camera : public shared_memory_delivery<usb_camera, HandleException> {
         public:
-        specialized_camera<HandleEvent, HandleException>(
-            HandleEvent handle_event,
+        specialized_shared_memory_camera<HandleException>(
             HandleException handle_exception,
+            const std::string& name,
             std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter,
-            std::size_t fifo_size,
+            std::size_t capacity,
             uint16_t serial,
-            std::chrono::milliseconds sleep_duration) :
-            sepia::specialized_camera<sepia::atis_event, HandleEvent, HandleException>(
-                std::forward<HandleEvent>(handle_event),
+            std::chrono::milliseconds sleep_duration,
+            std::size_t transfer_size,
+            std::size_t transfer_count,
+            const std::string& raw_filename,
+            std::shared_ptr<const pixel_mask> mask,
+            reconnect_policy reconnection,
+            placement_policy placement) :
+            shared_memory_delivery<usb_camera, HandleException>(
                 std::forward<HandleException>(handle_exception),
-                fifo_size,
-                sleep_duration),
-            _parameter(default_parameter()),
-            _acquisition_running(true) {
-            _parameter->parse_or_load(std::move(unvalidated_parameter));
+                name,
+                capacity,
+                transfer_size,
+                std::move(unvalidated_parameter),
+                serial,
+                sleep_duration,
+                transfer_size,
+                transfer_count,
+                raw_filename,
+                std::move(mask),
+                reconnection,
+                placement,
+                nullptr,
+                nullptr) {}
+        specialized_shared_memory_camera(const specialized_shared_memory_camera&) = delete;
+        specialized_shared_memory_camera(specialized_shared_memory_camera&&) = delete;
+        specialized_shared_memory_camera& operator=(const specialized_shared_memory_camera&) = delete;
+        specialized_shared_memory_camera& operator=(specialized_shared_memory_camera&&) = delete;
+        virtual ~specialized_shared_memory_camera() {}
+    };
 
-            // initialize the context
-            check_usb_error(libusb_init(&_context), "initializing the USB context");
+    /// make_shared_memory_camera creates a camera publishing its events to the POSIX shared memory object name.
+    /// name must start with a slash (for example "/ccam_atis"), and capacity must be a power of two.
+    /// The other parameters behave as in make_camera.
+    template <typename HandleException>
+    std::unique_ptr<specialized_shared_memory_camera<HandleException>> make_shared_memory_camera(
+        HandleException handle_exception,
+        const std::string& name,
+        std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter =
+            std::unique_ptr<sepia::unvalidated_parameter>(),
+        std::size_t capacity = 1 << 24,
+        uint16_t serial = 0,
+        std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10),
+        std::size_t transfer_size = 1 << 17,
+        std::size_t transfer_count = 0,
+        const std::string& raw_filename = std::string(),
+        std::shared_ptr<const pixel_mask> mask = std::shared_ptr<const pixel_mask>(),
+        reconnect_policy reconnection = reconnect_policy(),
+        placement_policy placement = placement_policy()) {
+        return sepia::make_unique<specialized_shared_memory_camera<HandleException>>(
+            std::forward<HandleException>(handle_exception),
+            name,
+            std::move(unvalidated_parameter),
+            capacity,
+            serial,
+            sleep_duration,
+            transfer_size,
+            transfer_count,
+            raw_filename,
+            std::move(mask),
+            reconnection,
+            placement);
+    }
+#endif
 
-            // find requested / available devices
-            {
-                auto device_found = false;
-                libusb_device** devices;
-                const auto count = libusb_get_device_list(_context, &devices);
-                for (ssize_t index = 0; index < count; ++index) {
-                    libusb_device_descriptor descriptor;
-                    if (libusb_get_device_descriptor(devices[index], &descriptor) == 0) {
-                        if (descriptor.idVendor == 1204 && descriptor.idProduct == 244) {
-                            check_usb_error(libusb_open(devices[index], &_handle), "opening the device");
-                            if (libusb_claim_interface(_handle, 0) == 0) {
-                                if (serial == 0) {
-                                    device_found = true;
-                                    break;
-                                } else {
-                                    auto data = std::array<uint8_t, 8>{};
-                                    check_usb_error(
-                                        libusb_control_transfer(
-                                            _handle,
-                                            192,
-                                            85,
-                                            32,
-                                            0,
-                                            data.data(),
-                                            static_cast<uint16_t>(data.size()),
-                                            0),
-                                        "sending a control packet");
-                                    if ((serial & 0xff) == data[6] && ((serial & 0xff00) >> 8) == data[7]) {
-                                        device_found = true;
-                                        break;
-                                    }
-                                }
-                                libusb_release_interface(_handle, 0);
+    /// group_member is a CCam ATIS driven by a camera_group.
+    /// It shares the group's USB context, and its transfers are serviced by the group's event thread.
+    /// Its events are mapped to the group's timebase and written to a lane read by the group's merge thread.
+    /// The group's timebase counts microseconds of host time since the group's epoch. Once the member's clock fit has
+    /// two samples, timestamps are mapped with the fit (see byte_sink::clock_fit), which follows the drift between
+    /// the cameras' clocks. Until then, timestamps are offset by the member's start time.
+    /// Mapped timestamps are clamped so that they never decrease, since the fit moves as samples are added.
+    /// When the lane fills up, the member applies its overflow policy (see overflow_mode).
+    class group_member : public usb_camera {
+        public:
+        group_member(
+            std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter,
+            uint16_t serial,
+            std::chrono::milliseconds transfer_timeout,
+            std::size_t transfer_size,
+            std::size_t transfer_count,
+            std::size_t lane_size,
+            overflow_policy policy,
+            libusb_context* context,
+            device_registry* registry) :
+            usb_camera(
+                std::move(unvalidated_parameter),
+                serial,
+                transfer_timeout,
+                transfer_size,
+                transfer_count,
+                std::string(),
+                std::shared_ptr<const pixel_mask>(),
+                reconnect_policy(),
+                placement_policy(),
+                context,
+                registry),
+            _offset(0),
+            _previous_t(0),
+            _watermark(0),
+            _lane(lane_size),
+            _head(0),
+            _tail(0),
+            _event_shedder(policy, lane_size),
+            _pushed_events(0),
+            _popped_events(0),
+            _skip_until(0),
+            _skipped_events(0) {}
+        group_member(const group_member&) = delete;
+        group_member(group_member&&) = delete;
+        group_member& operator=(const group_member&) = delete;
+        group_member& operator=(group_member&&) = delete;
+        virtual ~group_member() {}
+        virtual acquisition_statistics statistics() const override {
+            auto statistics = usb_camera::statistics();
+            statistics.shed_events += _skipped_events.load(std::memory_order_relaxed);
+            return statistics;
+        }
+
+        /// start_time_point returns the host time at which the camera was told to start reading.
+        virtual std::chrono::steady_clock::time_point start_time_point() const {
+            return _start_time_point;
+        }
+
+        /// epoch returns the host time at which the group's timebase starts.
+        virtual std::chrono::steady_clock::time_point epoch() const {
+            return _epoch;
+        }
+
+        /// set_epoch sets the host time at which the group's timebase starts.
+        /// It must be called before begin, with a time point earlier than the member's start time.
+        virtual void set_epoch(std::chrono::steady_clock::time_point epoch) {
+            _epoch = epoch;
+            _offset = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(_start_time_point - _epoch).count());
+            _previous_t = _offset;
+            _watermark.store(_offset, std::memory_order_release);
+        }
+
+        /// begin submits the member's transfers, and must be called on the group's event thread.
+        virtual void begin() {
+            _acquisition_running.store(true, std::memory_order_relaxed);
+            submit_transfers();
+        }
+
+        /// end cancels the member's transfers, and must be called on the group's event thread.
+        virtual void end() {
+            _acquisition_running.store(false, std::memory_order_relaxed);
+            cancel_transfers();
+        }
+
+        /// active returns false once every transfer has completed or been cancelled.
+        virtual bool active() const {
+            return _active_transfers > 0;
+        }
+
+        /// failure returns the acquisition error, or a null pointer if the acquisition has not failed.
+        virtual std::exception_ptr failure() const {
+            return _transfer_exception;
+        }
+
+        /// watermark returns a lower bound on the timestamps of the events not yet written to the lane.
+        /// It must be read before the lane, since the lane is written before the watermark is updated.
+        virtual uint64_t watermark() const {
+            return _watermark.load(std::memory_order_acquire);
+        }
+
+        /// front returns the oldest event in the lane, or a null pointer if the lane is empty.
+        /// Events that the producer asked to skip (overflow_mode::drop_oldest) are removed first.
+        virtual const sepia::atis_event* front() {
+            for (;;) {
+                const auto current_tail = _tail.load(std::memory_order_relaxed);
+                if (current_tail == _head.load(std::memory_order_acquire)) {
+                    return nullptr;
+                }
+                if (_popped_events.load(std::memory_order_relaxed) < _skip_until.load(std::memory_order_acquire)) {
+                    pop();
+                    _skipped_events.store(
+                        _skipped_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                } else {
+                    return &_lane[current_tail];
+                }
+            }
+        }
+
+        /// pop removes the oldest event from the lane, which must not be empty.
+        virtual void pop() {
+            _popped_events.store(_popped_events.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            _tail.store((_tail.load(std::memory_order_relaxed) + 1) % _lane.size(), std::memory_order_release);
+        }
+
+        protected:
+        /// group_t maps a device timestamp to the group's timebase with the given fit.
+        virtual uint64_t group_t(uint64_t t, const host_clock_fit& fit) const {
+            if (fit.samples < 2) {
+                return t + _offset;
+            }
+            const auto delta = fit.host_time(t) - _epoch;
+            return delta.count() < 0 ?
+                       0 :
+                       static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(delta).count());
+        }
+
+        /// dispatch_bytes raises the watermark once the transfer's events are in the lane.
+        virtual void dispatch_bytes(const uint8_t* bytes, std::size_t size, bool timed_out) override {
+            usb_camera::dispatch_bytes(bytes, size, timed_out);
+            _previous_t = std::max(_previous_t, group_t(_latest_t.load(std::memory_order_relaxed), _clock.fit()));
+            _watermark.store(_previous_t, std::memory_order_release);
+        }
+
+        /// handle_bytes decodes raw bytes from the camera and writes the mapped events to the lane.
+        /// The fit is read once per transfer, so that the transfer's events are mapped consistently.
+        virtual void handle_bytes(const uint8_t* bytes, std::size_t size) override {
+            const auto fit = _clock.fit();
+            // the transfer yields at most one event per word, plus one for a partial word
+            auto remaining_events = static_cast<uint64_t>(size / 4 + 1);
+            auto skipping = false;
+            std::size_t shed_events = 0;
+            decode(bytes, size, _decode_state, _transfer_mask.get(), [&](sepia::atis_event event) {
+                --remaining_events;
+                _previous_t = std::max(_previous_t, group_t(event.t, fit));
+                event.t = _previous_t;
+                const auto current_head = _head.load(std::memory_order_relaxed);
+                const auto next_head = (current_head + 1) % _lane.size();
+                if (_event_shedder.shed(event, fifo_occupancy())) {
+                    ++shed_events;
+                } else if (next_head == _tail.load(std::memory_order_acquire)) {
+                    switch (_event_shedder.policy().mode) {
+                        case overflow_mode::fail:
+                            throw std::runtime_error("computer's FIFO overflow");
+                        case overflow_mode::drop_oldest:
+                            if (!skipping) {
+                                skip_oldest(remaining_events);
+                                skipping = true;
                             }
-                            libusb_close(_handle);
-                        }
+                            break;
+                        default:
+                            break;
                     }
+                    ++shed_events;
+                } else {
+                    _lane[current_head] = event;
+                    _head.store(next_head, std::memory_order_release);
+                    ++_pushed_events;
                 }
-                libusb_free_device_list(devices, 1);
-                if (!device_found) {
-                    libusb_exit(_context);
-                    throw sepia::no_device_connected("CCam ATIS");
-                }
+            });
+            if (shed_events > 0) {
+                _telemetry.add_shed_events(shed_events);
+            }
+        }
+
+        virtual std::size_t fifo_occupancy() const override {
+            const auto current_head = _head.load(std::memory_order_relaxed);
+            const auto current_tail = _tail.load(std::memory_order_relaxed);
+            return (current_head + _lane.size() - current_tail) % _lane.size();
+        }
+
+        /// skip_oldest makes the merge thread skip the oldest waiting events (at most count).
+        /// The merge thread skips them as it reads them, hence skip_oldest returns immediately.
+        void skip_oldest(uint64_t count) {
+            const auto skip_until =
+                std::min(_pushed_events, _popped_events.load(std::memory_order_acquire) + count);
+            if (skip_until > _skip_until.load(std::memory_order_relaxed)) {
+                _skip_until.store(skip_until, std::memory_order_release);
             }
+        }
 
-            // allocate a transfer
-            _transfer = libusb_alloc_transfer(0);
+        /// handle_acquisition_exception is never called, since the group reads failure instead.
+        virtual void handle_acquisition_exception(std::exception_ptr) override {}
 
-            // send setup commands to the camera
-            check_usb_error(libusb_reset_device(_handle), "resetting the device");
-            send_command(_handle, 0x01a, {0, 0, 0x00, 0x01}, "setting the role");
-            send_command(_handle, 0x41a, {0, 0, 0x00, 0x02}, "setting the role");
+        std::chrono::steady_clock::time_point _epoch;
+        uint64_t _offset;
+        uint64_t _previous_t;
+        std::atomic<uint64_t> _watermark;
+        std::vector<sepia::atis_event> _lane;
+        std::atomic<std::size_t> _head;
+        std::atomic<std::size_t> _tail;
+        event_shedder _event_shedder;
+        uint64_t _pushed_events;
+        std::atomic<uint64_t> _popped_events;
+        std::atomic<uint64_t> _skip_until;
+        std::atomic<uint64_t> _skipped_events;
+    };
+
+    /// camera_group acquires from several CCam ATIS with a single USB context.
+    /// The members resolve their serials with a registry owned by the group, built on the same context.
+    /// The transfers of every camera are serviced by one event thread, and a merge thread passes the events
+    /// to handle_event(camera_index, event) in timestamp order.
+    /// Each member maps its timestamps to host time with its clock fit (see group_member), hence the cameras remain
+    /// aligned despite their clocks' drift. The alignment is as accurate as the fits' residuals, and the timebase
+    /// starts at the earliest host time at which a camera was told to start reading.
+    template <typename HandleEvent, typename HandleException>
+    class camera_group {
+        public:
+        camera_group<HandleEvent, HandleException>(
+            HandleEvent handle_event,
+            HandleException handle_exception,
+            const std::vector<uint16_t>& serials,
+            std::vector<std::unique_ptr<sepia::unvalidated_parameter>> unvalidated_parameters,
+            std::size_t lane_size,
+            std::chrono::milliseconds sleep_duration,
+            std::size_t transfer_size,
+            std::size_t transfer_count,
+            overflow_policy policy) :
+            _handle_event(std::forward<HandleEvent>(handle_event)),
+            _handle_exception(std::forward<HandleException>(handle_exception)),
+            _sleep_duration(sleep_duration),
+            _running(true) {
+            if (serials.empty()) {
+                throw std::logic_error("a camera group requires at least one serial");
+            }
+            if (!unvalidated_parameters.empty() && unvalidated_parameters.size() != serials.size()) {
+                throw std::logic_error("a camera group requires either no parameters or one parameter per serial");
+            }
+            if (transfer_count == 0) {
+                throw std::logic_error("a camera group requires asynchronous transfers");
+            }
+            if (lane_size < 2) {
+                throw std::logic_error("the lane size must be at least 2");
+            }
             {
-                auto data = std::vector<uint8_t>{};
-                for (const auto& category_pair : configuration()) {
-                    for (const auto& setting_pair : category_pair.second) {
-                        {
-                            const auto value =
-                                (category_pair.first == "static" ? setting_pair.second.at("value") :
-                                                                   static_cast<uint32_t>(_parameter->get_number(
-                                                                       {category_pair.first, setting_pair.first})));
-                            data.push_back(static_cast<uint8_t>(value >> 24));
-                            data.push_back(static_cast<uint8_t>(value >> 16));
-                            data.push_back(static_cast<uint8_t>(value >> 8));
-                            data.push_back(static_cast<uint8_t>(value & 0xff));
+                const auto error = libusb_init(&_context);
+                if (error < 0) {
+                    throw std::logic_error(
+                        std::string("initializing the USB context failed: ")
+                        + libusb_strerror(static_cast<libusb_error>(error)));
+                }
+            }
+            try {
+                _registry = sepia::make_unique<device_registry>(_context);
+                for (std::size_t index = 0; index < serials.size(); ++index) {
+                    _members.push_back(sepia::make_unique<group_member>(
+                        unvalidated_parameters.empty() ? std::unique_ptr<sepia::unvalidated_parameter>() :
+                                                         std::move(unvalidated_parameters[index]),
+                        serials[index],
+                        sleep_duration,
+                        transfer_size,
+                        transfer_count,
+                        lane_size,
+                        policy,
+                        _context,
+                        _registry.get()));
+                }
+            } catch (...) {
+                _members.clear();
+                _registry.reset();
+                libusb_exit(_context);
+                throw;
+            }
+            auto earliest_start_time_point = _members.front()->start_time_point();
+            for (const auto& member : _members) {
+                earliest_start_time_point = std::min(earliest_start_time_point, member->start_time_point());
+            }
+            for (auto& member : _members) {
+                member->set_epoch(earliest_start_time_point);
+            }
+            _event_loop = std::thread([this]() -> void {
+                try {
+                    for (auto& member : _members) {
+                        member->begin();
+                    }
+                    timeval timeout;
+                    timeout.tv_sec = static_cast<decltype(timeout.tv_sec)>(_sleep_duration.count() / 1000);
+                    timeout.tv_usec = static_cast<decltype(timeout.tv_usec)>((_sleep_duration.count() % 1000) * 1000);
+                    auto cancelled = false;
+                    std::exception_ptr failure;
+                    for (;;) {
+                        auto active = false;
+                        for (const auto& member : _members) {
+                            active = active || member->active();
+                            if (!failure) {
+                                failure = member->failure();
+                            }
                         }
-                        {
-                            const auto tension = setting_pair.second.at("tension");
-                            data.push_back(static_cast<uint8_t>(tension >> 24));
-                            data.push_back(static_cast<uint8_t>(tension >> 16));
-                            data.push_back(static_cast<uint8_t>(tension >> 8));
-                            data.push_back(static_cast<uint8_t>(tension & 0xff));
+                        if (!active) {
+                            break;
                         }
-                        {
-                            const auto address = setting_pair.second.at("address");
-                            data.push_back(static_cast<uint8_t>(address >> 24));
-                            data.push_back(static_cast<uint8_t>(address >> 16));
-                            data.push_back(static_cast<uint8_t>(address >> 8));
-                            data.push_back(static_cast<uint8_t>(address & 0xff));
+                        if (!cancelled && (!_running.load(std::memory_order_relaxed) || failure)) {
+                            for (auto& member : _members) {
+                                member->end();
+                            }
+                            cancelled = true;
                         }
+                        auto remaining_timeout = timeout;
+                        libusb_handle_events_timeout_completed(_context, &remaining_timeout, nullptr);
                     }
+                    if (failure) {
+                        std::rethrow_exception(failure);
+                    }
+                } catch (...) {
+                    _handle_exception(std::current_exception());
                 }
-                check_usb_error(
-                    libusb_control_transfer(_handle, 64, 97, 0, 0, data.data(), static_cast<uint16_t>(data.size()), 0),
-                    "loading the biases");
-                check_usb_error(
-                    libusb_control_transfer(_handle, 64, 98, 0, 0, data.data(), static_cast<uint16_t>(data.size()), 0),
-                    "loading the biases");
-            }
-            send_command(_handle, 0x00a, {0, 0, 0x00, 0x40}, "flush the biases");
-            send_command(_handle, 0x40a, {0, 0, 0x00, 0x40}, "flush the biases");
-            send_command(_handle, 0x008, {0, 0, 0x03, 0x2c}, "set the mode");
-            send_command(_handle, 0x408, {0, 0, 0x03, 0x2c}, "set the mode");
-            {
-                auto data = std::array<uint8_t, 1024>{};
-                int32_t transferred;
-                libusb_bulk_transfer(_handle, 129, data.data(), data.size(), &transferred, 100);
-            }
-            send_command(_handle, 0x000, {0, 0, 0x0c, 0x81}, "start reading");
-            send_command(_handle, 0x400, {0, 0, 0x0c, 0x81}, "start reading");
-
-            // start the reading loop
-            _acquisition_loop = std::thread([this, serial]() -> void {
+            });
+            _merge_loop = std::thread([this]() -> void {
                 try {
-                    auto data = std::vector<uint8_t>(1 << 17);
-                    sepia::atis_event event;
-                    uint64_t t_offset;
-                    while (_acquisition_running.load(std::memory_order_relaxed)) {
-                        int32_t transferred = 0;
-                        const auto error = libusb_bulk_transfer(
-                            _handle,
-                            129,
-                            data.data(),
-                            static_cast<uint32_t>(data.size()),
-                            &transferred,
-                            static_cast<uint32_t>(this->_sleep_duration.count()));
-                        if ((error == 0 || error == LIBUSB_ERROR_TIMEOUT) && transferred % 4 == 0) {
-                            for (auto byte_iterator = data.begin();
-                                 byte_iterator != std::next(data.begin(), transferred);
-                                 std::advance(byte_iterator, 4)) {
-                                if (*std::next(byte_iterator, 3) == 0x80) {
-                                    t_offset = (static_cast<uint64_t>(*byte_iterator)
-                                                | (static_cast<uint64_t>(*std::next(byte_iterator, 1)) << 8)
-                                                | (static_cast<uint64_t>(*std::next(byte_iterator, 2)) << 16))
-                                               * 0x800;
-                                } else {
-                                    event.x = (static_cast<uint16_t>(*std::next(byte_iterator, 2) & 0x1) << 8)
-                                              + *std::next(byte_iterator, 1);
-                                    event.y = 239 - *byte_iterator;
-                                    event.t = t_offset
-                                              + ((static_cast<uint64_t>((*std::next(byte_iterator, 3) & 0xf)) << 7)
-                                                 | (*std::next(byte_iterator, 2) >> 1));
-                                    event.polarity = ((*std::next(byte_iterator, 3) & 0b10000) >> 4) == 1;
-                                    event.is_threshold_crossing = ((*std::next(byte_iterator, 3) & 0b100000) >> 5) == 1;
-                                    if (!this->push(event)) {
-                                        throw std::runtime_error("computer's FIFO overflow");
-                                    }
-                                }
-                            }
-                        } else {
-                            throw sepia::device_disconnected("CCam ATIS");
+                    while (_running.load(std::memory_order_relaxed)) {
+                        if (!merge()) {
+                            std::this_thread::sleep_for(_sleep_duration);
                         }
                     }
                 } catch (...) {
-                    this->_handle_exception(std::current_exception());
+                    _handle_exception(std::current_exception());
                 }
             });
         }
-        specialized_camera(const specialized_camera&) = delete;
-        specialized_camera(specialized_camera&&) = default;
-        specialized_camera& operator=(const specialized_camera&) = delete;
-        specialized_camera& operator=(specialized_camera&&) = default;
-        virtual ~specialized_camera() {
-            _acquisition_running.store(false, std::memory_order_relaxed);
-            _acquisition_loop.join();
-            libusb_release_interface(_handle, 0);
-            libusb_free_transfer(_transfer);
-            libusb_close(_handle);
+        camera_group(const camera_group&) = delete;
+        camera_group(camera_group&&) = delete;
+        camera_group& operator=(const camera_group&) = delete;
+        camera_group& operator=(camera_group&&) = delete;
+        virtual ~camera_group() {
+            _running.store(false, std::memory_order_relaxed);
+            _event_loop.join();
+            _merge_loop.join();
+            _members.clear();
+            _registry.reset();
             libusb_exit(_context);
         }
-        virtual void trigger() override {
-            // @TODO trigger the camera
+
+        /// size returns the number of cameras in the group.
+        virtual std::size_t size() const {
+            return _members.size();
+        }
+
+        /// member returns the camera with the given index, in the order of the serials.
+        /// It can be used to read statistics, set biases or set a mask while the acquisition is running.
+        virtual group_member& member(std::size_t index) {
+            return *_members.at(index);
         }
 
         protected:
-        std::unique_ptr<sepia::parameter> _parameter;
-        std::atomic_bool _acquisition_running;
+        /// merge passes events to the handler as long as no camera can produce an earlier event.
+        /// With few cameras, a linear scan of the lanes is cheaper than a heap.
+        /// It returns false if no event was passed.
+        virtual bool merge() {
+            auto merged = false;
+            for (;;) {
+                const sepia::atis_event* earliest_event = nullptr;
+                std::size_t earliest_index = 0;
+                auto bound = std::numeric_limits<uint64_t>::max();
+                for (std::size_t index = 0; index < _members.size(); ++index) {
+                    const auto watermark = _members[index]->watermark();
+                    const auto event = _members[index]->front();
+                    if (event == nullptr) {
+                        bound = std::min(bound, watermark);
+                    } else if (earliest_event == nullptr || event->t < earliest_event->t) {
+                        earliest_event = event;
+                        earliest_index = index;
+                    }
+                }
+                if (earliest_event == nullptr || earliest_event->t > bound) {
+                    return merged;
+                }
+                _handle_event(earliest_index, *earliest_event);
+                _members[earliest_index]->pop();
+                merged = true;
+            }
+        }
+
+        HandleEvent _handle_event;
+        HandleException _handle_exception;
+        const std::chrono::milliseconds _sleep_duration;
+        std::atomic_bool _running;
         libusb_context* _context;
-        libusb_device_handle* _handle;
-        libusb_transfer* _transfer;
-        std::thread _acquisition_loop;
+        std::unique_ptr<device_registry> _registry;
+        std::vector<std::unique_ptr<group_member>> _members;
+        std::thread _event_loop;
+        std::thread _merge_loop;
     };
 
-    /// make_camera creates a camera from functors.
+    /// make_camera_group creates a camera group from functors.
+    /// handle_event is called with the camera's index (in the order of serials) and the event.
+    /// unvalidated_parameters must be empty (default biases) or contain one parameter per serial.
+    /// Each camera keeps transfer_count asynchronous transfers of transfer_size bytes in flight,
+    /// and buffers up to lane_size events while the other cameras catch up.
+    /// policy determines the behaviour of a camera whose lane fills up (see overflow_mode).
     template <typename HandleEvent, typename HandleException>
-    std::unique_ptr<specialized_camera<HandleEvent, HandleException>> make_camera(
+    std::unique_ptr<camera_group<HandleEvent, HandleException>> make_camera_group(
         HandleEvent handle_event,
         HandleException handle_exception,
-        std::unique_ptr<sepia::unvalidated_parameter> unvalidated_parameter =
-            std::unique_ptr<sepia::unvalidated_parameter>(),
+        const std::vector<uint16_t>& serials,
+        std::vector<std::unique_ptr<sepia::unvalidated_parameter>> unvalidated_parameters =
+            std::vector<std::unique_ptr<sepia::unvalidated_parameter>>(),
+        std::size_t lane_size = 1 << 22,
+        std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10),
+        std::size_t transfer_size = 1 << 17,
+        std::size_t transfer_count = 4,
+        overflow_policy policy = overflow_policy()) {
+        return sepia::make_unique<camera_group<HandleEvent, HandleException>>(
+            std::forward<HandleEvent>(handle_event),
+            std::forward<HandleException>(handle_exception),
+            serials,
+            std::move(unvalidated_parameters),
+            lane_size,
+            sleep_duration,
+            transfer_size,
+            transfer_count,
+            policy);
+    }
+
+    /// specialized_replay_camera represents a template-specialized CCam ATIS reading a raw file.
+    /// The file's chunks go through the same decoder, mask and FIFO as a live camera's transfers.
+    /// The exception handler is called with sepia::end_of_file once every event has been handled.
+    template <typename HandleEvent, typename HandleException>
+    class specialized_replay_camera : public event_delivery<replay_source, HandleEvent, HandleException> {
+        public:
+        specialized_replay_camera<HandleEvent, HandleException>(
+            HandleEvent handle_event,
+            HandleException handle_exception,
+            const std::string& filename,
+            double speed_up,
+            std::size_t fifo_size,
+            std::chrono::milliseconds sleep_duration,
+            overflow_policy policy,
+            std::shared_ptr<const pixel_mask> mask,
+            placement_policy placement) :
+            event_delivery<replay_source, HandleEvent, HandleException>(
+                std::forward<HandleEvent>(handle_event),
+                std::forward<HandleException>(handle_exception),
+                fifo_size,
+                sleep_duration,
+                policy,
+                filename,
+                speed_up,
+                sleep_duration,
+                std::move(mask),
+                placement) {}
+        specialized_replay_camera(const specialized_replay_camera&) = delete;
+        specialized_replay_camera(specialized_replay_camera&&) = delete;
+        specialized_replay_camera& operator=(const specialized_replay_camera&) = delete;
+        specialized_replay_camera& operator=(specialized_replay_camera&&) = delete;
+        virtual ~specialized_replay_camera() {}
+    };
+
+    /// make_replay_camera creates a replay camera from functors.
+    /// speed_up sets the pace of the replay, computed from the chunks' host timestamps.
+    /// 1 replays in real time, N replays N times faster and 0 replays as fast as possible.
+    /// Paced replays apply policy on FIFO overflow like a live camera, whereas as-fast-as-possible replays wait.
+    /// mask and placement behave as with make_camera.
+    template <typename HandleEvent, typename HandleException>
+    std::unique_ptr<specialized_replay_camera<HandleEvent, HandleException>> make_replay_camera(
+        HandleEvent handle_event,
+        HandleException handle_exception,
+        const std::string& filename,
+        double speed_up = 1.0,
         std::size_t fifo_size = 1 << 24,
-        uint16_t serial = 0,
-        std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10)) {
-        return sepia::make_unique<specialized_camera<HandleEvent, HandleException>>(
+        std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10),
+        overflow_policy policy = overflow_policy(),
+        std::shared_ptr<const pixel_mask> mask = std::shared_ptr<const pixel_mask>(),
+        placement_policy placement = placement_policy()) {
+        return sepia::make_unique<specialized_replay_camera<HandleEvent, HandleException>>(
             std::forward<HandleEvent>(handle_event),
             std::forward<HandleException>(handle_exception),
-            std::move(unvalidated_parameter),
+            filename,
+            speed_up,
             fifo_size,
-            serial,
-            sleep_duration);
+            sleep_duration,
+            policy,
+            std::move(mask),
+            placement);
     }
 }
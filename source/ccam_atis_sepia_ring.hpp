@@ -0,0 +1,271 @@
+#pragma once
+
+#include "../third_party/sepia/source/sepia.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <new>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// ccam_atis_sepia shares CCam ATIS events between processes.
+/// This header only depends on sepia, so that readers do not need to link to libusb.
+namespace ccam_atis_sepia {
+#if !defined(_WIN32)
+    /// shared_ring_header is stored at the beginning of a shared event ring, followed by the events.
+    /// The writer announces the events it is about to overwrite with reserve_index,
+    /// writes them, then makes them visible with write_index.
+    struct shared_ring_header {
+        /// signature identifies a ring and its version.
+        std::array<char, 16> signature;
+
+        /// capacity is the number of events in the ring, a power of two.
+        uint64_t capacity;
+
+        /// event_size is sizeof(sepia::atis_event) in the writer's process.
+        uint64_t event_size;
+
+        /// writer_pid is the process identifier of the writer.
+        int64_t writer_pid;
+
+        /// reserve_index is an upper bound on the index of the events being written.
+        alignas(64) std::atomic<uint64_t> reserve_index;
+
+        /// write_index is the number of events written so far.
+        alignas(64) std::atomic<uint64_t> write_index;
+
+        /// closed is set once the writer has stopped.
+        alignas(64) std::atomic<uint32_t> closed;
+    };
+
+    /// shared_ring_signature returns the signature of shared rings.
+    inline std::array<char, 16> shared_ring_signature() {
+        return {{'C', 'C', 'a', 'm', ' ', 'A', 'T', 'I', 'S', ' ', 'r', 'i', 'n', 'g', 2, 0}};
+    }
+
+    /// shared_ring_events_offset returns the offset of the events from the beginning of the ring, in bytes.
+    constexpr std::size_t shared_ring_events_offset() {
+        return (sizeof(shared_ring_header) + 63) / 64 * 64;
+    }
+
+    /// shared_ring_is_abandoned returns true if the shared memory object name is a ring whose writer is gone,
+    /// either because it stopped or because its process no longer exists.
+    /// It returns false if the object does not exist, is not a ring, or belongs to a running writer.
+    inline bool shared_ring_is_abandoned(const std::string& name) {
+        const auto descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+        if (descriptor < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(descriptor, &status) < 0 || static_cast<std::size_t>(status.st_size) < sizeof(shared_ring_header)) {
+            close(descriptor);
+            return false;
+        }
+        auto memory = mmap(nullptr, sizeof(shared_ring_header), PROT_READ, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        const auto header = static_cast<const shared_ring_header*>(memory);
+        const auto abandoned =
+            header->signature == shared_ring_signature()
+            && (header->closed.load(std::memory_order_acquire) != 0
+                || (kill(static_cast<pid_t>(header->writer_pid), 0) < 0 && errno == ESRCH));
+        munmap(memory, sizeof(shared_ring_header));
+        return abandoned;
+    }
+
+    /// shared_ring_writer creates a POSIX shared memory event ring, and publishes events to it.
+    /// The writer never waits for the readers, which detect the events they missed (see shared_ring_reader).
+    /// A ring left by a writer that stopped or crashed is replaced, whereas a ring with a running writer
+    /// (or any other object with the same name) makes the constructor throw.
+    /// The ring is removed when the writer is destroyed, processes that mapped it keep their mapping.
+    class shared_ring_writer {
+        public:
+        shared_ring_writer(const std::string& name, std::size_t capacity) :
+            _name(name),
+            _capacity(capacity),
+            _size(shared_ring_events_offset() + capacity * sizeof(sepia::atis_event)),
+            _index(0) {
+            if (_capacity < 2 || (_capacity & (_capacity - 1)) != 0) {
+                throw std::logic_error("the ring capacity must be a power of two");
+            }
+            auto descriptor = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (descriptor < 0 && errno == EEXIST && shared_ring_is_abandoned(_name)) {
+                // the readers of the abandoned ring keep their mapping
+                shm_unlink(_name.c_str());
+                descriptor = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+            }
+            if (descriptor < 0) {
+                if (errno == EEXIST) {
+                    throw std::runtime_error("the shared memory '" + _name + "' is used by another writer");
+                }
+                throw std::runtime_error("creating the shared memory '" + _name + "' failed");
+            }
+            if (ftruncate(descriptor, static_cast<off_t>(_size)) < 0) {
+                close(descriptor);
+                shm_unlink(_name.c_str());
+                throw std::runtime_error("resizing the shared memory '" + _name + "' failed");
+            }
+            auto memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            close(descriptor);
+            if (memory == MAP_FAILED) {
+                shm_unlink(_name.c_str());
+                throw std::runtime_error("mapping the shared memory '" + _name + "' failed");
+            }
+            _header = new (memory) shared_ring_header;
+            _header->signature = shared_ring_signature();
+            _header->capacity = _capacity;
+            _header->event_size = sizeof(sepia::atis_event);
+            _header->writer_pid = static_cast<int64_t>(getpid());
+            _header->reserve_index.store(0, std::memory_order_relaxed);
+            _header->write_index.store(0, std::memory_order_relaxed);
+            _header->closed.store(0, std::memory_order_release);
+            _events = reinterpret_cast<sepia::atis_event*>(static_cast<uint8_t*>(memory) + shared_ring_events_offset());
+        }
+        shared_ring_writer(const shared_ring_writer&) = delete;
+        shared_ring_writer(shared_ring_writer&&) = delete;
+        shared_ring_writer& operator=(const shared_ring_writer&) = delete;
+        shared_ring_writer& operator=(shared_ring_writer&&) = delete;
+        virtual ~shared_ring_writer() {
+            _header->closed.store(1, std::memory_order_release);
+            munmap(_header, _size);
+            shm_unlink(_name.c_str());
+        }
+
+        /// capacity returns the number of events in the ring.
+        std::size_t capacity() const {
+            return _capacity;
+        }
+
+        /// reserve announces that at most count events will be pushed before the next publish.
+        void reserve(std::size_t count) {
+            _header->reserve_index.store(
+                _header->write_index.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        /// push writes an event to the ring, without making it visible.
+        void push(sepia::atis_event event) {
+            _events[_index & (_capacity - 1)] = event;
+            ++_index;
+        }
+
+        /// publish makes the pushed events visible to the readers.
+        void publish() {
+            _header->write_index.store(_index, std::memory_order_release);
+        }
+
+        protected:
+        const std::string _name;
+        const std::size_t _capacity;
+        const std::size_t _size;
+        shared_ring_header* _header;
+        sepia::atis_event* _events;
+        uint64_t _index;
+    };
+
+    /// shared_ring_reader maps a shared event ring created by another process, and reads its events.
+    /// Each reader has its own cursor, and starts with the events published after it was created.
+    /// Events overwritten before they could be read are skipped and counted by lost_events.
+    class shared_ring_reader {
+        public:
+        shared_ring_reader(const std::string& name) : _lost_events(0) {
+            const auto descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+            if (descriptor < 0) {
+                throw sepia::unreadable_file(name);
+            }
+            struct stat status;
+            if (fstat(descriptor, &status) < 0
+                || static_cast<std::size_t>(status.st_size) < shared_ring_events_offset()) {
+                close(descriptor);
+                throw sepia::unreadable_file(name);
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            auto memory = mmap(nullptr, _size, PROT_READ, MAP_SHARED, descriptor, 0);
+            close(descriptor);
+            if (memory == MAP_FAILED) {
+                throw sepia::unreadable_file(name);
+            }
+            _header = static_cast<const shared_ring_header*>(memory);
+            if (_header->signature != shared_ring_signature() || _header->event_size != sizeof(sepia::atis_event)
+                || _size < shared_ring_events_offset() + _header->capacity * sizeof(sepia::atis_event)) {
+                munmap(memory, _size);
+                throw std::runtime_error("'" + name + "' is not a compatible CCam ATIS ring");
+            }
+            _capacity = _header->capacity;
+            _events = reinterpret_cast<const sepia::atis_event*>(
+                static_cast<const uint8_t*>(memory) + shared_ring_events_offset());
+            _cursor = _header->write_index.load(std::memory_order_acquire);
+        }
+        shared_ring_reader(const shared_ring_reader&) = delete;
+        shared_ring_reader(shared_ring_reader&&) = delete;
+        shared_ring_reader& operator=(const shared_ring_reader&) = delete;
+        shared_ring_reader& operator=(shared_ring_reader&&) = delete;
+        virtual ~shared_ring_reader() {
+            munmap(const_cast<shared_ring_header*>(_header), _size);
+        }
+
+        /// read copies at most maximum_count unread events to events, and returns the number of events copied.
+        /// The events are validated after the copy, since the writer does not wait for the readers.
+        std::size_t read(sepia::atis_event* events, std::size_t maximum_count) {
+            const auto write_index = _header->write_index.load(std::memory_order_acquire);
+            if (write_index - _cursor > _capacity) {
+                _lost_events += write_index - _capacity - _cursor;
+                _cursor = write_index - _capacity;
+            }
+            auto count =
+                static_cast<std::size_t>(std::min(static_cast<uint64_t>(maximum_count), write_index - _cursor));
+            const auto begin = static_cast<std::size_t>(_cursor & (_capacity - 1));
+            const auto first_count = std::min(count, static_cast<std::size_t>(_capacity) - begin);
+            std::memcpy(events, _events + begin, first_count * sizeof(sepia::atis_event));
+            std::memcpy(events + first_count, _events, (count - first_count) * sizeof(sepia::atis_event));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const auto reserve_index = _header->reserve_index.load(std::memory_order_relaxed);
+            if (reserve_index > _capacity && _cursor < reserve_index - _capacity) {
+                // the oldest copied events may have been overwritten during the copy
+                const auto overwritten = static_cast<std::size_t>(
+                    std::min(static_cast<uint64_t>(count), reserve_index - _capacity - _cursor));
+                std::memmove(events, events + overwritten, (count - overwritten) * sizeof(sepia::atis_event));
+                _lost_events += overwritten;
+                _cursor += overwritten;
+                count -= overwritten;
+            }
+            _cursor += count;
+            return count;
+        }
+
+        /// available returns the number of events published but not read yet (overwritten events included).
+        uint64_t available() const {
+            return _header->write_index.load(std::memory_order_acquire) - _cursor;
+        }
+
+        /// lost_events returns the number of events overwritten before this reader could read them.
+        uint64_t lost_events() const {
+            return _lost_events;
+        }
+
+        /// closed returns true once the writer has stopped.
+        /// Events published before may still be read.
+        bool closed() const {
+            return _header->closed.load(std::memory_order_acquire) != 0;
+        }
+
+        protected:
+        std::size_t _size;
+        const shared_ring_header* _header;
+        const sepia::atis_event* _events;
+        uint64_t _capacity;
+        uint64_t _cursor;
+        uint64_t _lost_events;
+    };
+#endif
+}
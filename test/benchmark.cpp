@@ -0,0 +1,810 @@
+#include "detached_camera.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+/// spatial_distribution determines the pixels of synthetic events.
+enum class spatial_distribution {
+    /// uniform draws pixels uniformly over the sensor.
+    uniform,
+
+    /// hotspot draws pixels from a Gaussian blob at the centre of the sensor.
+    hotspot,
+
+    /// edge draws pixels from a vertical edge sweeping across the sensor, as a moving object would.
+    edge,
+
+    /// pixel emits every event from the same pixel.
+    pixel,
+};
+
+/// generator_parameters configures the synthetic stream.
+struct generator_parameters {
+    /// event_rate is the number of events per second of device time.
+    double event_rate = 20e6;
+
+    /// overflow_density is the probability that a word is a redundant overflow marker,
+    /// in addition to the markers the camera emits every 2048 microseconds.
+    double overflow_density = 0.0;
+
+    /// threshold_crossing_ratio is the fraction of events that are threshold crossings.
+    double threshold_crossing_ratio = 0.5;
+
+    /// distribution determines the pixels of the events.
+    spatial_distribution distribution = spatial_distribution::uniform;
+
+    /// events is the number of events in the stream.
+    std::size_t events = 1 << 23;
+
+    /// seed initialises the random number generator, for reproducible streams.
+    uint32_t seed = 0;
+};
+
+/// event_word encodes an event as a CCam ATIS word, t being the offset from the last overflow marker.
+inline uint32_t event_word(uint16_t x, uint16_t y, uint32_t t, bool polarity, bool is_threshold_crossing) {
+    return static_cast<uint32_t>(239 - y) | (static_cast<uint32_t>(x & 0xff) << 8)
+           | ((((t & 0x7f) << 1) | static_cast<uint32_t>(x >> 8)) << 16)
+           | (((is_threshold_crossing ? 0b100000u : 0u) | (polarity ? 0b10000u : 0u) | ((t >> 7) & 0xf)) << 24);
+}
+
+/// overflow_word encodes an overflow marker.
+inline uint32_t overflow_word(uint32_t counter) {
+    return (counter & 0xffffff) | 0x80000000;
+}
+
+/// generate returns a valid CCam ATIS byte stream, starting with an overflow marker.
+/// Inter-event intervals follow an exponential distribution, so that the rate is met on average.
+inline std::vector<uint8_t> generate(const generator_parameters& parameters) {
+    std::mt19937_64 engine(parameters.seed);
+    std::exponential_distribution<double> interval(parameters.event_rate / 1e6);
+    std::bernoulli_distribution is_overflow(parameters.overflow_density);
+    std::bernoulli_distribution is_threshold_crossing(parameters.threshold_crossing_ratio);
+    std::bernoulli_distribution polarity(0.5);
+    std::uniform_int_distribution<uint32_t> uniform_x(0, 303);
+    std::uniform_int_distribution<uint32_t> uniform_y(0, 239);
+    std::normal_distribution<double> hotspot_x(152, 20);
+    std::normal_distribution<double> hotspot_y(120, 20);
+    std::normal_distribution<double> edge_jitter(0, 1.5);
+    std::vector<uint32_t> words;
+    words.reserve(parameters.events + parameters.events / 8);
+    uint32_t counter = 0;
+    words.push_back(overflow_word(counter));
+    double t = 0;
+    for (std::size_t index = 0; index < parameters.events;) {
+        if (parameters.overflow_density > 0 && is_overflow(engine)) {
+            words.push_back(overflow_word(counter));
+            continue;
+        }
+        t += interval(engine);
+        const auto integer_t = static_cast<uint64_t>(t);
+        while (counter < integer_t / 0x800) {
+            ++counter;
+            words.push_back(overflow_word(counter));
+        }
+        uint16_t x = 0;
+        uint16_t y = 0;
+        switch (parameters.distribution) {
+            case spatial_distribution::uniform:
+                x = static_cast<uint16_t>(uniform_x(engine));
+                y = static_cast<uint16_t>(uniform_y(engine));
+                break;
+            case spatial_distribution::hotspot:
+                x = static_cast<uint16_t>(std::min(std::max(hotspot_x(engine), 0.0), 303.0));
+                y = static_cast<uint16_t>(std::min(std::max(hotspot_y(engine), 0.0), 239.0));
+                break;
+            case spatial_distribution::edge:
+                // the edge crosses the sensor in 100 ms
+                x = static_cast<uint16_t>(
+                    std::min(std::max(std::fmod(t / 100000.0, 1.0) * 304 + edge_jitter(engine), 0.0), 303.0));
+                y = static_cast<uint16_t>(uniform_y(engine));
+                break;
+            case spatial_distribution::pixel:
+                x = 152;
+                y = 120;
+                break;
+        }
+        words.push_back(event_word(
+            x,
+            y,
+            static_cast<uint32_t>(integer_t % 0x800),
+            polarity(engine),
+            is_threshold_crossing(engine)));
+        ++index;
+    }
+    std::vector<uint8_t> bytes(words.size() * 4);
+    for (std::size_t index = 0; index < words.size(); ++index) {
+        for (std::size_t shift = 0; shift < 4; ++shift) {
+            bytes[index * 4 + shift] = static_cast<uint8_t>(words[index] >> (8 * shift));
+        }
+    }
+    return bytes;
+}
+
+/// chunk is a slice of the stream, standing for a USB transfer.
+struct chunk {
+    /// begin is the offset of the chunk's first byte in the stream.
+    std::size_t begin;
+
+    /// size is the number of bytes in the chunk.
+    std::size_t size;
+
+    /// last_event is the number of events handled once the chunk is decoded.
+    uint64_t last_event;
+
+    /// t is the timestamp of the chunk's last event, in microseconds.
+    uint64_t t;
+};
+
+/// split_chunks splits the stream into transfer_size chunks, and decodes it once to count their events.
+inline std::vector<chunk>
+split_chunks(const std::vector<uint8_t>& bytes, std::size_t transfer_size, const ccam_atis_sepia::pixel_mask* mask) {
+    std::vector<chunk> chunks;
+    ccam_atis_sepia::decode_state state;
+    uint64_t events = 0;
+    uint64_t t = 0;
+    for (std::size_t begin = 0; begin < bytes.size(); begin += transfer_size) {
+        const auto size = std::min(transfer_size, bytes.size() - begin);
+        ccam_atis_sepia::decode(bytes.data() + begin, size, state, mask, [&](sepia::atis_event event) {
+            ++events;
+            t = event.t;
+        });
+        chunks.push_back({begin, size, events, t});
+    }
+    return chunks;
+}
+
+/// chunk_events returns the number of events in a chunk.
+inline uint64_t chunk_events(const std::vector<chunk>& chunks, std::size_t index) {
+    return chunks[index].last_event - (index == 0 ? 0 : chunks[index - 1].last_event);
+}
+
+/// latency_probe counts handled events, and measures the delay between a chunk's arrival and its last event.
+/// The clock is read once per chunk, hence the probe barely slows down the handler.
+class latency_probe {
+    public:
+    latency_probe(const std::vector<chunk>& chunks) :
+        _chunks(chunks),
+        _arrivals(chunks.size()),
+        _latencies(chunks.size()),
+        _events(0),
+        _chunk_index(0) {}
+
+    /// arrive records the arrival of a chunk, before its bytes are decoded.
+    void arrive(std::size_t index) {
+        _arrivals[index] = std::chrono::steady_clock::now();
+    }
+
+    /// operator() handles an event.
+    void operator()(sepia::atis_event) {
+        handle(1);
+    }
+
+    /// handle handles count events at once, for buffered deliveries.
+    void handle(uint64_t count) {
+        _events += count;
+        while (_chunk_index < _chunks.size() && _events >= _chunks[_chunk_index].last_event) {
+            _latencies[_chunk_index] = std::chrono::steady_clock::now() - _arrivals[_chunk_index];
+            ++_chunk_index;
+        }
+    }
+
+    /// events returns the number of handled events.
+    uint64_t events() const {
+        return _events;
+    }
+
+    /// latencies returns the sorted latencies of the handled chunks, ignoring chunks without events.
+    std::vector<std::chrono::steady_clock::duration> latencies() const {
+        std::vector<std::chrono::steady_clock::duration> latencies;
+        latencies.reserve(_chunk_index);
+        for (std::size_t index = 0; index < _chunk_index; ++index) {
+            if (chunk_events(_chunks, index) > 0) {
+                latencies.push_back(_latencies[index]);
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    }
+
+    protected:
+    const std::vector<chunk>& _chunks;
+    std::vector<std::chrono::steady_clock::time_point> _arrivals;
+    std::vector<std::chrono::steady_clock::duration> _latencies;
+    uint64_t _events;
+    std::size_t _chunk_index;
+};
+
+/// delivery_parameters configures the cameras fed with the synthetic stream.
+struct delivery_parameters {
+    /// fifo_size is the number of events in the camera's FIFO, or in the shared memory ring.
+    std::size_t fifo_size = 1 << 24;
+
+    /// buffer_count is the number of buffers of the buffered camera.
+    std::size_t buffer_count = 1 << 8;
+
+    /// slice_duration is the duration of the buffered camera's slices, 0 meaning one buffer per transfer.
+    uint64_t slice_duration = 0;
+
+    /// sleep_duration is the time the consumer waits when its FIFO is empty.
+    std::chrono::milliseconds sleep_duration = std::chrono::milliseconds(10);
+
+    /// speed_up paces the transfers, 1 being real time and 0 as fast as possible.
+    double speed_up = 0;
+
+    /// backpressure makes the producer wait for room in the FIFO, as a replay at full speed would.
+    /// Otherwise, the overflow policy applies.
+    bool backpressure = true;
+
+    /// policy determines the behaviour of the camera when its FIFO fills up.
+    ccam_atis_sepia::overflow_policy policy;
+
+    /// shared_name is the shared memory object written by the shared mode.
+    std::string shared_name = "/ccam_atis_sepia_benchmark";
+
+    /// timeout bounds each wait for the consumer, so that a stalled consumer fails the run instead of hanging it.
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(60000);
+};
+
+/// consumer_watchdog collects the consumer's exception, and bounds the producer's waits for the consumer.
+class consumer_watchdog {
+    public:
+    consumer_watchdog(std::chrono::milliseconds timeout) : _timeout(timeout), _failed(false) {}
+
+    /// fail records the consumer's exception, and is called on the consumer thread.
+    void fail(std::exception_ptr exception) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _exception = exception;
+        _failed.store(true, std::memory_order_release);
+    }
+
+    /// wait_until yields until done returns true.
+    /// It throws the consumer's exception if the consumer failed, and a runtime_error after the timeout.
+    template <typename Done>
+    void wait_until(Done done) {
+        const auto deadline = std::chrono::steady_clock::now() + _timeout;
+        while (!done()) {
+            if (_failed.load(std::memory_order_acquire)) {
+                rethrow();
+            }
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("timed out waiting for the consumer");
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /// rethrow throws the consumer's exception, if any.
+    void rethrow() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+    }
+
+    protected:
+    const std::chrono::milliseconds _timeout;
+    std::atomic_bool _failed;
+    std::mutex _mutex;
+    std::exception_ptr _exception;
+};
+
+/// result holds the measurements of a benchmark mode.
+/// Latencies are not reported if events were discarded, since chunks are then never completely handled.
+struct result {
+    std::string mode;
+    uint64_t events;
+    uint64_t discarded_events;
+    std::chrono::steady_clock::duration duration;
+    std::vector<std::chrono::steady_clock::duration> latencies;
+};
+
+/// sleep_until_chunk paces the producer so that chunks arrive at speed_up times the device's pace.
+inline void
+sleep_until_chunk(std::chrono::steady_clock::time_point start, const chunk& current_chunk, double speed_up) {
+    if (speed_up > 0) {
+        std::this_thread::sleep_until(
+            start
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::micro>(static_cast<double>(current_chunk.t) / speed_up)));
+    }
+}
+
+/// feed_chunks passes the chunks to a detached camera, from the calling thread.
+/// With backpressure, the producer waits until has_room(index) returns true before passing a chunk.
+template <typename Camera, typename HasRoom>
+inline void feed_chunks(
+    Camera& camera,
+    const std::vector<uint8_t>& bytes,
+    const std::vector<chunk>& chunks,
+    latency_probe& probe,
+    const delivery_parameters& delivery,
+    std::chrono::steady_clock::time_point begin,
+    consumer_watchdog& watchdog,
+    HasRoom has_room) {
+    for (std::size_t index = 0; index < chunks.size(); ++index) {
+        sleep_until_chunk(begin, chunks[index], delivery.speed_up);
+        if (delivery.backpressure) {
+            watchdog.wait_until([&]() { return has_room(index); });
+        }
+        probe.arrive(index);
+        camera.feed(bytes.data() + chunks[index].begin, chunks[index].size);
+    }
+}
+
+/// run_decode measures the decoder alone, vectorised or word by word, and keeps the fastest pass.
+inline result run_decode(
+    const std::string& mode,
+    const std::vector<uint8_t>& bytes,
+    std::size_t transfer_size,
+    const ccam_atis_sepia::pixel_mask* mask,
+    bool word_by_word,
+    std::size_t passes) {
+    const auto chunks = split_chunks(bytes, transfer_size, mask);
+    result best{mode, 0, 0, std::chrono::steady_clock::duration::max(), {}};
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        latency_probe probe(chunks);
+        ccam_atis_sepia::decode_state state;
+        const auto begin = std::chrono::steady_clock::now();
+        for (std::size_t index = 0; index < chunks.size(); ++index) {
+            probe.arrive(index);
+            const auto data = bytes.data() + chunks[index].begin;
+            if (word_by_word) {
+                for (std::size_t offset = 0; offset + 4 <= chunks[index].size; offset += 4) {
+                    ccam_atis_sepia::decode_word(data + offset, state, mask, probe);
+                }
+            } else {
+                ccam_atis_sepia::decode(data, chunks[index].size, state, mask, probe);
+            }
+        }
+        const auto duration = std::chrono::steady_clock::now() - begin;
+        if (duration < best.duration) {
+            best.events = probe.events();
+            best.duration = duration;
+            best.latencies = probe.latencies();
+        }
+    }
+    return best;
+}
+
+/// run_camera measures the path of ccam_atis_sepia::make_camera: byte_sink::dispatch_bytes,
+/// event_delivery::handle_bytes (decoder, overflow policy and FIFO push) and the consumer thread.
+inline result run_camera(
+    const std::vector<uint8_t>& bytes,
+    std::size_t transfer_size,
+    const delivery_parameters& delivery) {
+    const auto chunks = split_chunks(bytes, transfer_size, nullptr);
+    if (delivery.backpressure) {
+        for (std::size_t index = 0; index < chunks.size(); ++index) {
+            if (chunk_events(chunks, index) > delivery.fifo_size - 1) {
+                throw std::runtime_error("the FIFO is smaller than a transfer, increase --fifo-size");
+            }
+        }
+    }
+    latency_probe probe(chunks);
+    std::atomic<uint64_t> handled_events(0);
+    consumer_watchdog watchdog(delivery.timeout);
+    uint64_t discarded_events = 0;
+    std::chrono::steady_clock::duration duration;
+    {
+        detached_camera<ccam_atis_sepia::event_delivery<
+            ccam_atis_sepia::byte_sink,
+            std::function<void(sepia::atis_event)>,
+            std::function<void(std::exception_ptr)>>>
+            camera(
+                [&](sepia::atis_event event) {
+                    probe(event);
+                    handled_events.store(probe.events(), std::memory_order_release);
+                },
+                [&](std::exception_ptr exception) { watchdog.fail(exception); },
+                delivery.fifo_size,
+                delivery.sleep_duration,
+                delivery.policy,
+                std::string(),
+                std::shared_ptr<const ccam_atis_sepia::pixel_mask>(),
+                ccam_atis_sepia::placement_policy());
+        const auto begin = std::chrono::steady_clock::now();
+        feed_chunks(camera, bytes, chunks, probe, delivery, begin, watchdog, [&](std::size_t index) {
+            return camera.fifo_occupancy() + chunk_events(chunks, index) <= delivery.fifo_size - 1;
+        });
+        watchdog.wait_until([&]() {
+            discarded_events = camera.statistics().shed_events;
+            return handled_events.load(std::memory_order_acquire) + discarded_events >= chunks.back().last_event;
+        });
+        duration = std::chrono::steady_clock::now() - begin;
+    }
+    watchdog.rethrow();
+    return {"camera",
+            probe.events(),
+            discarded_events,
+            duration,
+            discarded_events == 0 ? probe.latencies() : std::vector<std::chrono::steady_clock::duration>()};
+}
+
+/// run_buffered measures the path of ccam_atis_sepia::make_buffered_camera: byte_sink::dispatch_bytes,
+/// buffer_delivery::handle_bytes (decoder, overflow policy and batching) and the consumer thread.
+/// In slice mode, the last buffer is only published once an event reaches the next slice,
+/// hence the stream is followed by an event one slice later, which is not counted.
+inline result run_buffered(
+    const std::vector<uint8_t>& bytes,
+    std::size_t transfer_size,
+    const delivery_parameters& delivery) {
+    const auto chunks = split_chunks(bytes, transfer_size, nullptr);
+
+    // a chunk publishes at most one buffer per slice it spans, plus the buffers filled to capacity
+    std::vector<std::size_t> maximum_buffers(chunks.size());
+    for (std::size_t index = 0; index < chunks.size(); ++index) {
+        maximum_buffers[index] = 2;
+        if (delivery.slice_duration > 0) {
+            maximum_buffers[index] += static_cast<std::size_t>(std::min(
+                chunk_events(chunks, index),
+                (chunks[index].t - (index == 0 ? 0 : chunks[index - 1].t)) / delivery.slice_duration + 1));
+        }
+        if (delivery.backpressure && maximum_buffers[index] > delivery.buffer_count - 1) {
+            throw std::runtime_error("a transfer may span more buffers than available, increase --buffers");
+        }
+    }
+    latency_probe probe(chunks);
+    std::atomic<uint64_t> handled_events(0);
+    consumer_watchdog watchdog(delivery.timeout);
+    uint64_t discarded_events = 0;
+    std::chrono::steady_clock::duration duration;
+    {
+        detached_camera<ccam_atis_sepia::buffer_delivery<
+            ccam_atis_sepia::byte_sink,
+            std::function<void(const std::vector<sepia::atis_event>&)>,
+            std::function<void(std::exception_ptr)>>>
+            camera(
+                [&](const std::vector<sepia::atis_event>& events) {
+                    probe.handle(events.size());
+                    handled_events.store(probe.events(), std::memory_order_release);
+                },
+                [&](std::exception_ptr exception) { watchdog.fail(exception); },
+                delivery.buffer_count,
+                transfer_size / 4,
+                delivery.sleep_duration,
+                delivery.slice_duration,
+                delivery.policy,
+                std::string(),
+                std::shared_ptr<const ccam_atis_sepia::pixel_mask>(),
+                ccam_atis_sepia::placement_policy());
+        const auto begin = std::chrono::steady_clock::now();
+        feed_chunks(camera, bytes, chunks, probe, delivery, begin, watchdog, [&](std::size_t index) {
+            return camera.fifo_occupancy() + maximum_buffers[index] <= delivery.buffer_count - 1;
+        });
+        if (delivery.slice_duration > 0) {
+            const auto counter = static_cast<uint32_t>((chunks.back().t + delivery.slice_duration) / 0x800 + 1);
+            std::vector<uint8_t> flush;
+            for (const auto word : {overflow_word(counter), event_word(0, 0, 0, false, false)}) {
+                for (std::size_t shift = 0; shift < 4; ++shift) {
+                    flush.push_back(static_cast<uint8_t>(word >> (8 * shift)));
+                }
+            }
+            if (delivery.backpressure) {
+                watchdog.wait_until([&]() { return camera.fifo_occupancy() + 1 <= delivery.buffer_count - 1; });
+            }
+            camera.feed(flush.data(), flush.size());
+        }
+        watchdog.wait_until([&]() {
+            discarded_events = camera.statistics().shed_events;
+            return handled_events.load(std::memory_order_acquire) + discarded_events >= chunks.back().last_event;
+        });
+        duration = std::chrono::steady_clock::now() - begin;
+    }
+    watchdog.rethrow();
+    return {"buffered",
+            probe.events(),
+            discarded_events,
+            duration,
+            discarded_events == 0 ? probe.latencies() : std::vector<std::chrono::steady_clock::duration>()};
+}
+
+#if !defined(_WIN32)
+/// run_shared measures the path of ccam_atis_sepia::make_shared_memory_camera: byte_sink::dispatch_bytes,
+/// shared_memory_delivery::handle_bytes (decoder and ring publication) and a shared_ring_reader.
+/// The reader runs on a thread of this process, and events it misses are counted as discarded.
+inline result run_shared(
+    const std::vector<uint8_t>& bytes,
+    std::size_t transfer_size,
+    const delivery_parameters& delivery) {
+    const auto chunks = split_chunks(bytes, transfer_size, nullptr);
+    latency_probe probe(chunks);
+    std::atomic<uint64_t> read_events(0);
+    std::atomic<uint64_t> lost_events(0);
+    std::atomic_bool reading(true);
+    consumer_watchdog watchdog(delivery.timeout);
+    std::chrono::steady_clock::duration duration;
+    {
+        detached_camera<ccam_atis_sepia::shared_memory_delivery<
+            ccam_atis_sepia::byte_sink,
+            std::function<void(std::exception_ptr)>>>
+            camera(
+                [&](std::exception_ptr exception) { watchdog.fail(exception); },
+                delivery.shared_name,
+                delivery.fifo_size,
+                transfer_size,
+                std::string(),
+                std::shared_ptr<const ccam_atis_sepia::pixel_mask>(),
+                ccam_atis_sepia::placement_policy());
+        ccam_atis_sepia::shared_ring_reader reader(delivery.shared_name);
+        std::thread reader_loop([&]() {
+            std::vector<sepia::atis_event> events(transfer_size / 4 + 1);
+            while (reading.load(std::memory_order_relaxed)
+                   && read_events.load(std::memory_order_relaxed) + lost_events.load(std::memory_order_relaxed)
+                          < chunks.back().last_event) {
+                const auto count = reader.read(events.data(), events.size());
+                lost_events.store(reader.lost_events(), std::memory_order_relaxed);
+                if (count > 0) {
+                    probe.handle(count);
+                    read_events.store(probe.events(), std::memory_order_release);
+                } else {
+                    std::this_thread::sleep_for(delivery.sleep_duration);
+                }
+            }
+        });
+        const auto begin = std::chrono::steady_clock::now();
+        // the writer reserves one slot per word before decoding a transfer, and readers must stay within the ring
+        try {
+            feed_chunks(camera, bytes, chunks, probe, delivery, begin, watchdog, [&](std::size_t index) {
+                return (index == 0 ? 0 : chunks[index - 1].last_event) + chunks[index].size / 4 + 1
+                       <= read_events.load(std::memory_order_acquire) + delivery.fifo_size;
+            });
+        } catch (...) {
+            reading.store(false, std::memory_order_relaxed);
+            reader_loop.join();
+            throw;
+        }
+        reader_loop.join();
+        duration = std::chrono::steady_clock::now() - begin;
+    }
+    watchdog.rethrow();
+    const auto discarded_events = lost_events.load(std::memory_order_relaxed);
+    return {"shared",
+            probe.events(),
+            discarded_events,
+            duration,
+            discarded_events == 0 ? probe.latencies() : std::vector<std::chrono::steady_clock::duration>()};
+}
+#endif
+
+/// run_replay measures ccam_atis_sepia::make_replay_camera on the stream written as a raw file.
+/// Chunk latencies are not observable from outside the camera, hence only the throughput is measured.
+inline result run_replay(
+    const std::vector<uint8_t>& bytes,
+    std::size_t transfer_size,
+    std::size_t fifo_size,
+    std::chrono::milliseconds sleep_duration,
+    const std::string& filename) {
+    {
+        std::ofstream output(filename, std::ofstream::binary);
+        if (!output.good()) {
+            throw sepia::unwritable_file(filename);
+        }
+        const auto file_signature = ccam_atis_sepia::raw_recorder::signature();
+        output.write(file_signature.data(), static_cast<std::streamsize>(file_signature.size()));
+        for (std::size_t begin = 0; begin < bytes.size(); begin += transfer_size) {
+            const auto size = std::min(transfer_size, bytes.size() - begin);
+            std::array<uint8_t, ccam_atis_sepia::raw_recorder::chunk_header_size()> header;
+            for (std::size_t index = 0; index < 8; ++index) {
+                header[index] = 0;
+            }
+            for (std::size_t index = 0; index < 4; ++index) {
+                header[8 + index] = static_cast<uint8_t>(size >> (8 * index));
+            }
+            output.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+            output.write(reinterpret_cast<const char*>(bytes.data() + begin), static_cast<std::streamsize>(size));
+        }
+    }
+    uint64_t events = 0;
+    sepia::capture_exception capture_exception;
+    const auto begin = std::chrono::steady_clock::now();
+    {
+        auto camera = ccam_atis_sepia::make_replay_camera(
+            [&](sepia::atis_event) { ++events; },
+            std::ref(capture_exception),
+            filename,
+            0.0,
+            fifo_size,
+            sleep_duration);
+        capture_exception.wait();
+    }
+    const auto duration = std::chrono::steady_clock::now() - begin;
+    std::remove(filename.c_str());
+    capture_exception.rethrow_unless<sepia::end_of_file>();
+    return {"replay", events, 0, duration, {}};
+}
+
+/// print writes a result as a table row, latencies in microseconds.
+inline void print(const result& row) {
+    const auto seconds = std::chrono::duration<double>(row.duration).count();
+    std::cout << std::left << std::setw(14) << row.mode << std::right << std::setw(12) << row.events << std::fixed
+              << std::setprecision(1) << std::setw(10) << static_cast<double>(row.events) / seconds / 1e6;
+    if (row.events == 0) {
+        std::cout << std::setw(10) << "-";
+    } else {
+        std::cout << std::setprecision(2) << std::setw(10) << seconds * 1e9 / static_cast<double>(row.events);
+    }
+    std::cout << std::setw(12) << row.discarded_events;
+    for (const auto percentile : {0.5, 0.9, 0.99, 0.999, 1.0}) {
+        if (row.latencies.empty()) {
+            std::cout << std::setw(10) << "-";
+        } else {
+            const auto index = std::min(
+                row.latencies.size() - 1,
+                static_cast<std::size_t>(percentile * static_cast<double>(row.latencies.size())));
+            std::cout << std::setprecision(1) << std::setw(10)
+                      << std::chrono::duration<double, std::micro>(row.latencies[index]).count();
+        }
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string usage =
+        "usage: ccam_atis_sepia_benchmark [options]\n"
+        "    --rate <events per second>         device event rate (default 20e6)\n"
+        "    --overflow-density <probability>   redundant overflow markers per word (default 0)\n"
+        "    --threshold-crossings <ratio>      fraction of threshold crossings (default 0.5)\n"
+        "    --distribution <name>              uniform, hotspot, edge or pixel (default uniform)\n"
+        "    --events <count>                   events in the stream (default 8388608)\n"
+        "    --seed <integer>                   random seed (default 0)\n"
+        "    --transfer-size <bytes>            bytes per simulated transfer (default 131072)\n"
+        "    --fifo-size <events>               FIFO and shared memory ring size (default 16777216)\n"
+        "    --buffers <count>                  buffers of the buffered mode (default 256)\n"
+        "    --slice <microseconds>             slice duration of the buffered mode, 0 for one buffer per transfer\n"
+        "                                       (default 0)\n"
+        "    --overflow <name>                  wait, fail, drop_newest, drop_oldest, decimate\n"
+        "                                       or drop_threshold_crossings_first (default wait)\n"
+        "                                       wait makes the producer wait for room, as a replay does\n"
+        "    --sleep <milliseconds>             consumer sleep duration when idle (default 10)\n"
+        "    --speed-up <factor>                pace the camera modes, 1 being real time (default 0, unpaced)\n"
+        "    --timeout <milliseconds>           maximum wait for the consumer before failing (default 60000)\n"
+        "    --passes <count>                   decoder passes, the fastest is kept (default 5)\n"
+        "    --mode <name>                      decode, scalar, masked, masked_scalar, camera, buffered, shared,\n"
+        "                                       replay or all (default all)\n"
+        "                                       the masked modes keep the left half of the sensor\n"
+        "    --shared-name <name>               shared memory object of the shared mode\n"
+        "                                       (default /ccam_atis_sepia_benchmark)\n"
+        "    --raw <filename>                   temporary raw file for the replay mode\n"
+        "                                       (default ccam_atis_sepia_benchmark.raw)\n";
+    try {
+        generator_parameters parameters;
+        delivery_parameters delivery;
+        std::size_t transfer_size = 1 << 17;
+        std::size_t passes = 5;
+        std::string mode("all");
+        std::string raw_filename("ccam_atis_sepia_benchmark.raw");
+        for (int index = 1; index < argc; ++index) {
+            const std::string option(argv[index]);
+            if (option == "--help" || option == "-h") {
+                std::cout << usage;
+                return 0;
+            }
+            if (index + 1 >= argc) {
+                throw std::runtime_error("missing value for '" + option + "'\n" + usage);
+            }
+            const std::string value(argv[++index]);
+            if (option == "--rate") {
+                parameters.event_rate = std::stod(value);
+            } else if (option == "--overflow-density") {
+                parameters.overflow_density = std::stod(value);
+            } else if (option == "--threshold-crossings") {
+                parameters.threshold_crossing_ratio = std::stod(value);
+            } else if (option == "--distribution") {
+                if (value == "uniform") {
+                    parameters.distribution = spatial_distribution::uniform;
+                } else if (value == "hotspot") {
+                    parameters.distribution = spatial_distribution::hotspot;
+                } else if (value == "edge") {
+                    parameters.distribution = spatial_distribution::edge;
+                } else if (value == "pixel") {
+                    parameters.distribution = spatial_distribution::pixel;
+                } else {
+                    throw std::runtime_error("unknown distribution '" + value + "'\n" + usage);
+                }
+            } else if (option == "--events") {
+                parameters.events = static_cast<std::size_t>(std::stoull(value));
+            } else if (option == "--seed") {
+                parameters.seed = static_cast<uint32_t>(std::stoul(value));
+            } else if (option == "--transfer-size") {
+                transfer_size = static_cast<std::size_t>(std::stoull(value));
+            } else if (option == "--fifo-size") {
+                delivery.fifo_size = static_cast<std::size_t>(std::stoull(value));
+            } else if (option == "--buffers") {
+                delivery.buffer_count = static_cast<std::size_t>(std::stoull(value));
+            } else if (option == "--slice") {
+                delivery.slice_duration = static_cast<uint64_t>(std::stoull(value));
+            } else if (option == "--overflow") {
+                delivery.backpressure = value == "wait";
+                if (value == "wait" || value == "fail") {
+                    delivery.policy.mode = ccam_atis_sepia::overflow_mode::fail;
+                } else if (value == "drop_newest") {
+                    delivery.policy.mode = ccam_atis_sepia::overflow_mode::drop_newest;
+                } else if (value == "drop_oldest") {
+                    delivery.policy.mode = ccam_atis_sepia::overflow_mode::drop_oldest;
+                } else if (value == "decimate") {
+                    delivery.policy.mode = ccam_atis_sepia::overflow_mode::decimate;
+                } else if (value == "drop_threshold_crossings_first") {
+                    delivery.policy.mode = ccam_atis_sepia::overflow_mode::drop_threshold_crossings_first;
+                } else {
+                    throw std::runtime_error("unknown overflow mode '" + value + "'\n" + usage);
+                }
+            } else if (option == "--sleep") {
+                delivery.sleep_duration = std::chrono::milliseconds(std::stoll(value));
+            } else if (option == "--speed-up") {
+                delivery.speed_up = std::stod(value);
+            } else if (option == "--timeout") {
+                delivery.timeout = std::chrono::milliseconds(std::stoll(value));
+            } else if (option == "--passes") {
+                passes = static_cast<std::size_t>(std::stoull(value));
+            } else if (option == "--mode") {
+                mode = value;
+            } else if (option == "--shared-name") {
+                delivery.shared_name = value;
+            } else if (option == "--raw") {
+                raw_filename = value;
+            } else {
+                throw std::runtime_error("unknown option '" + option + "'\n" + usage);
+            }
+        }
+        if (parameters.event_rate <= 0 || parameters.overflow_density < 0 || parameters.overflow_density >= 1
+            || parameters.threshold_crossing_ratio < 0 || parameters.threshold_crossing_ratio > 1
+            || parameters.events == 0 || transfer_size < 4 || transfer_size % 4 != 0 || delivery.fifo_size < 2
+            || delivery.buffer_count < 2 || passes == 0) {
+            throw std::runtime_error("invalid parameters\n" + usage);
+        }
+        if (mode != "all" && mode != "decode" && mode != "scalar" && mode != "masked" && mode != "masked_scalar"
+            && mode != "camera" && mode != "buffered" && mode != "shared" && mode != "replay") {
+            throw std::runtime_error("unknown mode '" + mode + "'\n" + usage);
+        }
+        const auto bytes = generate(parameters);
+        std::cout << "decoder: "
+#if defined(CCAM_ATIS_SEPIA_AVX2)
+                  << "AVX2"
+#elif defined(CCAM_ATIS_SEPIA_SSE2)
+                  << "SSE2"
+#else
+                  << "scalar"
+#endif
+                  << ", words: " << bytes.size() / 4 << ", events: " << parameters.events << std::endl;
+        std::cout << std::left << std::setw(14) << "mode" << std::right << std::setw(12) << "events" << std::setw(10)
+                  << "Mev/s" << std::setw(10) << "ns/event" << std::setw(12) << "discarded" << std::setw(10)
+                  << "p50 us" << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(10) << "p99.9 us"
+                  << std::setw(10) << "max us" << std::endl;
+        if (mode == "all" || mode == "decode") {
+            print(run_decode("decode", bytes, transfer_size, nullptr, false, passes));
+        }
+        if (mode == "all" || mode == "scalar") {
+            print(run_decode("scalar", bytes, transfer_size, nullptr, true, passes));
+        }
+        {
+            // the mask keeps the left half of the sensor, hence uniform pixels make its bits unpredictable
+            const ccam_atis_sepia::pixel_mask mask(std::vector<ccam_atis_sepia::region_of_interest>{{0, 0, 152, 240}});
+            if (mode == "all" || mode == "masked") {
+                print(run_decode("masked", bytes, transfer_size, &mask, false, passes));
+            }
+            if (mode == "all" || mode == "masked_scalar") {
+                print(run_decode("masked_scalar", bytes, transfer_size, &mask, true, passes));
+            }
+        }
+        if (mode == "all" || mode == "camera") {
+            print(run_camera(bytes, transfer_size, delivery));
+        }
+        if (mode == "all" || mode == "buffered") {
+            print(run_buffered(bytes, transfer_size, delivery));
+        }
+#if !defined(_WIN32)
+        if (mode == "all" || mode == "shared") {
+            print(run_shared(bytes, transfer_size, delivery));
+        }
+#endif
+        if (mode == "all" || mode == "replay") {
+            print(run_replay(bytes, transfer_size, delivery.fifo_size, delivery.sleep_duration, raw_filename));
+        }
+    } catch (const std::exception& exception) {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "../source/ccam_atis_sepia.hpp"
+
+#include <iostream>
+#include <random>
+
+/// random_stream returns words with random fields, including pixels outside the sensor.
+/// One word out of overflow_period is an overflow marker with an increasing counter.
+inline std::vector<uint8_t> random_stream(std::size_t words, std::size_t overflow_period, uint32_t seed) {
+    std::mt19937 engine(seed);
+    std::vector<uint8_t> bytes;
+    bytes.reserve(words * 4);
+    uint32_t counter = 0;
+    for (std::size_t index = 0; index < words; ++index) {
+        auto word = static_cast<uint32_t>(engine());
+        if (engine() % overflow_period == 0) {
+            ++counter;
+            word = (counter & 0xffffff) | 0x80000000;
+        } else if ((word >> 24) == 0x80) {
+            word ^= 0x40000000;
+        }
+        for (std::size_t shift = 0; shift < 4; ++shift) {
+            bytes.push_back(static_cast<uint8_t>(word >> (8 * shift)));
+        }
+    }
+    return bytes;
+}
+
+/// reference decodes bytes one word at a time with decode_word.
+inline std::vector<sepia::atis_event> reference(
+    const std::vector<uint8_t>& bytes,
+    ccam_atis_sepia::decode_state& state,
+    const ccam_atis_sepia::pixel_mask* mask) {
+    std::vector<sepia::atis_event> events;
+    auto handle_event = [&](sepia::atis_event event) { events.push_back(event); };
+    for (std::size_t index = 0; index + 4 <= bytes.size(); index += 4) {
+        ccam_atis_sepia::decode_word(bytes.data() + index, state, mask, handle_event);
+    }
+    return events;
+}
+
+/// decode_in_buffers decodes bytes with decode, split into buffers of random sizes up to maximum_size.
+inline std::vector<sepia::atis_event> decode_in_buffers(
+    const std::vector<uint8_t>& bytes,
+    ccam_atis_sepia::decode_state& state,
+    const ccam_atis_sepia::pixel_mask* mask,
+    std::size_t maximum_size,
+    uint32_t seed) {
+    std::mt19937 engine(seed);
+    std::vector<sepia::atis_event> events;
+    for (std::size_t begin = 0; begin < bytes.size();) {
+        const auto size = std::min(static_cast<std::size_t>(engine() % (maximum_size + 1)), bytes.size() - begin);
+        ccam_atis_sepia::decode(
+            bytes.data() + begin, size, state, mask, [&](sepia::atis_event event) { events.push_back(event); });
+        begin += size;
+    }
+    return events;
+}
+
+/// equal compares two event sequences and two decoder states.
+inline bool equal(
+    const std::vector<sepia::atis_event>& expected_events,
+    const std::vector<sepia::atis_event>& events,
+    const ccam_atis_sepia::decode_state& expected_state,
+    const ccam_atis_sepia::decode_state& state) {
+    if (expected_events.size() != events.size()) {
+        std::cerr << "    expected " << expected_events.size() << " events, got " << events.size() << std::endl;
+        return false;
+    }
+    for (std::size_t index = 0; index < events.size(); ++index) {
+        const auto& expected = expected_events[index];
+        const auto& event = events[index];
+        if (expected.t != event.t || expected.x != event.x || expected.y != event.y
+            || expected.is_threshold_crossing != event.is_threshold_crossing || expected.polarity != event.polarity) {
+            std::cerr << "    event " << index << " differs (expected t=" << expected.t << " x=" << expected.x
+                      << " y=" << expected.y << ", got t=" << event.t << " x=" << event.x << " y=" << event.y << ")"
+                      << std::endl;
+            return false;
+        }
+    }
+    if (expected_state.t_offset != state.t_offset || expected_state.t_base != state.t_base
+        || expected_state.overflow_counter != state.overflow_counter
+        || expected_state.overflow_words != state.overflow_words
+        || expected_state.counter_discontinuities != state.counter_discontinuities
+        || expected_state.masked_events != state.masked_events) {
+        std::cerr << "    the decoder states differ" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// random_mask returns a mask with random bits.
+inline ccam_atis_sepia::pixel_mask random_mask(uint32_t seed) {
+    std::mt19937 engine(seed);
+    ccam_atis_sepia::pixel_mask mask(false);
+    for (uint16_t y = 0; y < 240; ++y) {
+        for (uint16_t x = 0; x < 304; ++x) {
+            mask.set(x, y, engine() % 3 != 0);
+        }
+    }
+    return mask;
+}
+
+/// push_word appends a little-endian word to bytes.
+inline void push_word(std::vector<uint8_t>& bytes, uint32_t word) {
+    for (std::size_t shift = 0; shift < 4; ++shift) {
+        bytes.push_back(static_cast<uint8_t>(word >> (8 * shift)));
+    }
+}
+
+/// event_word encodes an event at pixel (x, y), t being the offset from the last overflow marker.
+inline uint32_t event_word(uint16_t x, uint16_t y, uint32_t t) {
+    return static_cast<uint32_t>(239 - y) | (static_cast<uint32_t>(x & 0xff) << 8)
+           | ((((t & 0x7f) << 1) | static_cast<uint32_t>(x >> 8)) << 16) | (((t >> 7) & 0xf) << 24);
+}
+
+int main() {
+    std::size_t failures = 0;
+    auto check = [&](const std::string& name, bool passed) {
+        std::cout << name << ": " << (passed ? "passed" : "failed") << std::endl;
+        if (!passed) {
+            ++failures;
+        }
+    };
+    std::cout << "decoder: "
+#if defined(CCAM_ATIS_SEPIA_AVX2)
+              << "AVX2"
+#elif defined(CCAM_ATIS_SEPIA_SSE2)
+              << "SSE2"
+#else
+              << "scalar"
+#endif
+              << std::endl;
+    for (const auto overflow_period : {2, 50, 100000}) {
+        const auto bytes = random_stream(100003, static_cast<std::size_t>(overflow_period), 1);
+        const auto suffix = " (one overflow word out of " + std::to_string(overflow_period) + ")";
+        {
+            ccam_atis_sepia::decode_state expected_state;
+            const auto expected_events = reference(bytes, expected_state, nullptr);
+            ccam_atis_sepia::decode_state state;
+            std::vector<sepia::atis_event> events;
+            ccam_atis_sepia::decode(
+                bytes.data(), bytes.size(), state, [&](sepia::atis_event event) { events.push_back(event); });
+            check("decode matches decode_word" + suffix, equal(expected_events, events, expected_state, state));
+        }
+        {
+            const auto mask = random_mask(2);
+            ccam_atis_sepia::decode_state expected_state;
+            const auto expected_events = reference(bytes, expected_state, &mask);
+            ccam_atis_sepia::decode_state state;
+            std::vector<sepia::atis_event> events;
+            ccam_atis_sepia::decode(bytes.data(), bytes.size(), state, &mask, [&](sepia::atis_event event) {
+                events.push_back(event);
+            });
+            check(
+                "masked decode matches masked decode_word" + suffix,
+                equal(expected_events, events, expected_state, state));
+        }
+        {
+            const ccam_atis_sepia::pixel_mask mask(
+                std::vector<ccam_atis_sepia::region_of_interest>{{10, 20, 100, 50}, {200, 100, 104, 140}});
+            ccam_atis_sepia::decode_state expected_state;
+            const auto expected_events = reference(bytes, expected_state, &mask);
+            ccam_atis_sepia::decode_state state;
+            const auto events = decode_in_buffers(bytes, state, &mask, 4096, 3);
+            check(
+                "decode with regions of interest in split buffers matches decode_word" + suffix,
+                equal(expected_events, events, expected_state, state));
+        }
+        {
+            ccam_atis_sepia::decode_state expected_state;
+            const auto expected_events = reference(bytes, expected_state, nullptr);
+            ccam_atis_sepia::decode_state state;
+            const auto events = decode_in_buffers(bytes, state, nullptr, 67, 4);
+            check(
+                "decode in buffers of any size matches decode_word" + suffix,
+                equal(expected_events, events, expected_state, state));
+        }
+    }
+    {
+        // events preceding the first overflow word are relative to zero
+        std::vector<uint8_t> bytes;
+        push_word(bytes, event_word(0, 0, 0));
+        push_word(bytes, event_word(303, 239, 2047));
+        push_word(bytes, event_word(17, 42, 1000));
+        ccam_atis_sepia::decode_state state;
+        std::vector<sepia::atis_event> events;
+        ccam_atis_sepia::decode(
+            bytes.data(), bytes.size(), state, [&](sepia::atis_event event) { events.push_back(event); });
+        check(
+            "timestamps start at zero before the first overflow word",
+            events.size() == 3 && events[0].t == 0 && events[0].x == 0 && events[0].y == 0 && events[1].t == 2047
+                && events[1].x == 303 && events[1].y == 239 && events[2].t == 1000 && events[2].x == 17
+                && events[2].y == 42 && state.overflow_words == 0);
+    }
+    {
+        // an overflow word at the end of a buffer applies to the next buffer, including across a counter wrap
+        std::vector<uint8_t> first_bytes;
+        push_word(first_bytes, event_word(1, 1, 5));
+        push_word(first_bytes, 0x80000000 | 5);
+        std::vector<uint8_t> second_bytes;
+        for (uint32_t index = 0; index < 16; ++index) {
+            push_word(second_bytes, event_word(2, 2, index));
+        }
+        push_word(second_bytes, 0x80000000 | 0xffffff);
+        std::vector<uint8_t> third_bytes;
+        push_word(third_bytes, 0x80000000 | 1);
+        push_word(third_bytes, event_word(3, 3, 7));
+        ccam_atis_sepia::decode_state state;
+        std::vector<sepia::atis_event> events;
+        auto handle_event = [&](sepia::atis_event event) { events.push_back(event); };
+        ccam_atis_sepia::decode(first_bytes.data(), first_bytes.size(), state, handle_event);
+        ccam_atis_sepia::decode(second_bytes.data(), second_bytes.size(), state, handle_event);
+        ccam_atis_sepia::decode(third_bytes.data(), third_bytes.size(), state, handle_event);
+        auto passed = events.size() == 18 && events[0].t == 5;
+        for (uint32_t index = 0; passed && index < 16; ++index) {
+            passed = events[1 + index].t == 5 * 0x800 + index;
+        }
+        passed = passed && events[17].t == (static_cast<uint64_t>(1) << 35) + 0x800 + 7;
+        check("t_offset is carried across buffers and counter wraps", passed);
+    }
+    {
+        // a counter decrease smaller than half the range is a discontinuity, not a wrap
+        std::vector<uint8_t> bytes;
+        push_word(bytes, 0x80000000 | 1000);
+        push_word(bytes, event_word(1, 1, 3));
+        push_word(bytes, 0x80000000 | 10);
+        push_word(bytes, event_word(2, 2, 4));
+        push_word(bytes, 0x80000000 | 0xfffff0);
+        push_word(bytes, 0x80000000 | 2);
+        push_word(bytes, event_word(3, 3, 5));
+        ccam_atis_sepia::decode_state state;
+        std::vector<sepia::atis_event> events;
+        ccam_atis_sepia::decode(
+            bytes.data(), bytes.size(), state, [&](sepia::atis_event event) { events.push_back(event); });
+        check(
+            "a counter decrease within half the range is a discontinuity",
+            events.size() == 3 && events[0].t == 1000 * 0x800 + 3 && events[1].t == 10 * 0x800 + 4
+                && events[2].t == (static_cast<uint64_t>(1) << 35) + 2 * 0x800 + 5
+                && state.counter_discontinuities == 1 && state.overflow_words == 4);
+    }
+    if (failures > 0) {
+        std::cerr << failures << " test" << (failures > 1 ? "s" : "") << " failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
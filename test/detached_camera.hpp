@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../source/ccam_atis_sepia.hpp"
+
+/// detached_camera builds a delivery class on ccam_atis_sepia::byte_sink, without device, and exposes feed.
+/// Delivery is for example ccam_atis_sepia::event_delivery<ccam_atis_sepia::byte_sink, HandleEvent, HandleException>,
+/// and its arguments are followed by the byte sink's (raw filename, pixel mask and placement policy).
+/// It also exposes the FIFO occupancy, so that a producer can wait for room.
+template <typename Delivery>
+class detached_camera : public Delivery {
+    public:
+    template <typename... Arguments>
+    detached_camera(Arguments&&... arguments) : Delivery(std::forward<Arguments>(arguments)...) {}
+
+    /// feed passes raw bytes to the camera, as if a transfer had completed.
+    /// The calling thread plays the role of the acquisition thread, hence feed must not be called concurrently.
+    /// Delivery errors (for example a FIFO overflow with overflow_mode::fail) are thrown to the caller.
+    void feed(const uint8_t* bytes, std::size_t size) {
+        this->dispatch_bytes(bytes, size, false);
+    }
+
+    using Delivery::fifo_occupancy;
+};
@@ -0,0 +1,235 @@
+#include "detached_camera.hpp"
+
+#include <iostream>
+
+/// transfer returns the bytes of count events, whose abscissas are first, first + 1...
+inline std::vector<uint8_t> transfer(uint16_t first, uint16_t count) {
+    std::vector<uint8_t> bytes;
+    for (uint16_t x = first; x < first + count; ++x) {
+        const auto word = static_cast<uint32_t>(239) | (static_cast<uint32_t>(x & 0xff) << 8)
+                          | (static_cast<uint32_t>(x >> 8) << 16);
+        for (std::size_t shift = 0; shift < 4; ++shift) {
+            bytes.push_back(static_cast<uint8_t>(word >> (8 * shift)));
+        }
+    }
+    return bytes;
+}
+
+/// wait_until polls condition, and returns false if it is still false after a second.
+template <typename Condition>
+inline bool wait_until(Condition condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// stalled_consumer records the abscissas of the handled events, and blocks on the first one until released.
+class stalled_consumer {
+    public:
+    stalled_consumer() : _stalled(false), _released(false), _handled_events(0) {}
+
+    /// handle records count events, and blocks if they are the first ones.
+    void handle(const sepia::atis_event* events, std::size_t count) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (std::size_t index = 0; index < count; ++index) {
+                _xs.push_back(events[index].x);
+            }
+        }
+        if (!_stalled.exchange(true, std::memory_order_acq_rel)) {
+            while (!_released.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        _handled_events.fetch_add(count, std::memory_order_release);
+    }
+
+    /// stalled returns true once the first events are being handled.
+    bool stalled() const {
+        return _stalled.load(std::memory_order_acquire);
+    }
+
+    /// release unblocks the consumer.
+    void release() {
+        _released.store(true, std::memory_order_release);
+    }
+
+    /// handled_events returns the number of events handled so far.
+    uint64_t handled_events() const {
+        return _handled_events.load(std::memory_order_acquire);
+    }
+
+    /// xs returns the abscissas of the handled events, in order.
+    std::vector<uint16_t> xs() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _xs;
+    }
+
+    protected:
+    std::atomic_bool _stalled;
+    std::atomic_bool _released;
+    std::atomic<uint64_t> _handled_events;
+    std::mutex _mutex;
+    std::vector<uint16_t> _xs;
+};
+
+/// range returns the integers in [begin, end).
+inline std::vector<uint16_t> range(uint16_t begin, uint16_t end) {
+    std::vector<uint16_t> xs;
+    for (auto x = begin; x < end; ++x) {
+        xs.push_back(x);
+    }
+    return xs;
+}
+
+/// print_xs writes the handled abscissas to the error stream.
+inline void print_xs(const std::vector<uint16_t>& xs) {
+    std::cerr << "    handled:";
+    for (const auto x : xs) {
+        std::cerr << " " << x;
+    }
+    std::cerr << std::endl;
+}
+
+int main() {
+    std::size_t failures = 0;
+    auto check = [&](const std::string& name, bool passed) {
+        std::cout << name << ": " << (passed ? "passed" : "failed") << std::endl;
+        if (!passed) {
+            ++failures;
+        }
+    };
+    {
+        // the FIFO holds 63 events, and each transfer carries 16 events
+        stalled_consumer consumer;
+        std::exception_ptr consumer_exception;
+        std::vector<uint16_t> xs;
+        uint64_t shed_events = 0;
+        auto passed = true;
+        {
+            detached_camera<ccam_atis_sepia::event_delivery<
+                ccam_atis_sepia::byte_sink,
+                std::function<void(sepia::atis_event)>,
+                std::function<void(std::exception_ptr)>>>
+                camera(
+                    [&](sepia::atis_event event) { consumer.handle(&event, 1); },
+                    [&](std::exception_ptr exception) { consumer_exception = exception; },
+                    64,
+                    std::chrono::milliseconds(1),
+                    ccam_atis_sepia::overflow_policy(ccam_atis_sepia::overflow_mode::drop_oldest),
+                    std::string(),
+                    std::shared_ptr<const ccam_atis_sepia::pixel_mask>(),
+                    ccam_atis_sepia::placement_policy());
+            auto bytes = transfer(0, 16);
+            camera.feed(bytes.data(), bytes.size());
+            passed = wait_until([&]() { return consumer.stalled(); });
+
+            // events 1 to 63 fill the FIFO, events 64 to 199 overflow while the consumer is stalled
+            for (uint16_t first = 16; first < 200; first += 16) {
+                bytes = transfer(first, std::min(16, 200 - first));
+                camera.feed(bytes.data(), bytes.size());
+            }
+            consumer.release();
+
+            // events fed once the consumer has caught up must all be handled
+            for (uint16_t first = 200; passed && first < 296; first += 16) {
+                passed = wait_until([&]() {
+                    return consumer.handled_events() + camera.statistics().shed_events == first;
+                });
+                bytes = transfer(first, 16);
+                camera.feed(bytes.data(), bytes.size());
+            }
+            passed = passed && wait_until([&]() {
+                         return consumer.handled_events() + camera.statistics().shed_events == 296;
+                     });
+            shed_events = camera.statistics().shed_events;
+            xs = consumer.xs();
+        }
+        // the consumer skips as many of the oldest events as the rest of the overflowing transfer needs
+        // (15 words, plus one for a partial word), and the events that did not fit while it was stalled are discarded
+        auto expected_xs = std::vector<uint16_t>{0};
+        for (const auto x : range(17, 64)) {
+            expected_xs.push_back(x);
+        }
+        for (const auto x : range(200, 296)) {
+            expected_xs.push_back(x);
+        }
+        passed = passed && !consumer_exception && xs == expected_xs && shed_events == 16 + (200 - 64);
+        if (!passed) {
+            print_xs(xs);
+        }
+        check("drop_oldest skips one transfer of the oldest events", passed);
+    }
+    {
+        // the FIFO has 4 buffers (one handled, two waiting and one filled), and each transfer yields one buffer
+        stalled_consumer consumer;
+        std::exception_ptr consumer_exception;
+        std::vector<uint16_t> xs;
+        uint64_t shed_events = 0;
+        auto passed = true;
+        {
+            detached_camera<ccam_atis_sepia::buffer_delivery<
+                ccam_atis_sepia::byte_sink,
+                std::function<void(const std::vector<sepia::atis_event>&)>,
+                std::function<void(std::exception_ptr)>>>
+                camera(
+                    [&](const std::vector<sepia::atis_event>& events) {
+                        consumer.handle(events.data(), events.size());
+                    },
+                    [&](std::exception_ptr exception) { consumer_exception = exception; },
+                    4,
+                    16,
+                    std::chrono::milliseconds(1),
+                    0,
+                    ccam_atis_sepia::overflow_policy(ccam_atis_sepia::overflow_mode::drop_oldest),
+                    std::string(),
+                    std::shared_ptr<const ccam_atis_sepia::pixel_mask>(),
+                    ccam_atis_sepia::placement_policy());
+            auto bytes = transfer(0, 16);
+            camera.feed(bytes.data(), bytes.size());
+            passed = wait_until([&]() { return consumer.stalled(); });
+
+            // buffers 1 and 2 wait in the FIFO, buffers 3 and 4 overflow while the consumer is stalled
+            for (uint16_t first = 16; first < 80; first += 16) {
+                bytes = transfer(first, 16);
+                camera.feed(bytes.data(), bytes.size());
+            }
+            consumer.release();
+            for (uint16_t first = 80; passed && first < 160; first += 16) {
+                passed = wait_until([&]() {
+                    return consumer.handled_events() + camera.statistics().shed_events == first;
+                });
+                bytes = transfer(first, 16);
+                camera.feed(bytes.data(), bytes.size());
+            }
+            passed = passed && wait_until([&]() {
+                         return consumer.handled_events() + camera.statistics().shed_events == 160;
+                     });
+            shed_events = camera.statistics().shed_events;
+            xs = consumer.xs();
+        }
+        // the consumer skips the oldest waiting buffer, and the buffers that could not be published are discarded
+        auto expected_xs = range(0, 16);
+        for (const auto x : range(32, 48)) {
+            expected_xs.push_back(x);
+        }
+        for (const auto x : range(80, 160)) {
+            expected_xs.push_back(x);
+        }
+        passed = passed && !consumer_exception && xs == expected_xs && shed_events == 16 + 32;
+        if (!passed) {
+            print_xs(xs);
+        }
+        check("drop_oldest skips one of the oldest buffers", passed);
+    }
+    if (failures > 0) {
+        std::cerr << failures << " test" << (failures > 1 ? "s" : "") << " failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
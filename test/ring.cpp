@@ -0,0 +1,114 @@
+#include "../source/ccam_atis_sepia_ring.hpp"
+
+#include <iostream>
+#include <sys/wait.h>
+
+/// write_events pushes count events with consecutive timestamps, starting at t.
+inline void write_events(ccam_atis_sepia::shared_ring_writer& writer, uint64_t& t, std::size_t count) {
+    writer.reserve(count);
+    for (std::size_t index = 0; index < count; ++index) {
+        writer.push(sepia::atis_event{t, static_cast<uint16_t>(t % 304), static_cast<uint16_t>(t % 240), false, true});
+        ++t;
+    }
+    writer.publish();
+}
+
+/// consecutive returns true if the events' timestamps are consecutive, starting at t.
+inline bool consecutive(const std::vector<sepia::atis_event>& events, std::size_t count, uint64_t t) {
+    for (std::size_t index = 0; index < count; ++index) {
+        if (events[index].t != t + index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    const std::string name("/ccam_atis_sepia_ring_test");
+    std::size_t failures = 0;
+    auto check = [&](const std::string& test_name, bool passed) {
+        std::cout << test_name << ": " << (passed ? "passed" : "failed") << std::endl;
+        if (!passed) {
+            ++failures;
+        }
+    };
+    try {
+        std::vector<sepia::atis_event> events(1 << 12);
+        {
+            ccam_atis_sepia::shared_ring_writer writer(name, 1 << 10);
+            ccam_atis_sepia::shared_ring_reader fast_reader(name);
+            ccam_atis_sepia::shared_ring_reader slow_reader(name);
+            uint64_t t = 0;
+            uint64_t read_events = 0;
+            auto in_order = true;
+            for (std::size_t batch = 0; batch < 100; ++batch) {
+                write_events(writer, t, 300);
+                const auto count = fast_reader.read(events.data(), events.size());
+                in_order = in_order && consecutive(events, count, read_events);
+                read_events += count;
+            }
+            check(
+                "a reader keeping up gets every event in order",
+                in_order && read_events == t && fast_reader.lost_events() == 0);
+            const auto count = slow_reader.read(events.data(), events.size());
+            check(
+                "a slow reader gets the latest events and counts the others as lost",
+                count == writer.capacity() && consecutive(events, count, t - count)
+                    && slow_reader.lost_events() == t - count);
+            auto second_writer_failed = false;
+            try {
+                ccam_atis_sepia::shared_ring_writer second_writer(name, 1 << 10);
+            } catch (const std::runtime_error&) {
+                second_writer_failed = true;
+            }
+            check("a second writer cannot take over a running writer's ring", second_writer_failed);
+            check("the ring is open while its writer runs", !fast_reader.closed());
+            write_events(writer, t, 10);
+            ccam_atis_sepia::shared_ring_reader late_reader(name);
+            write_events(writer, t, 10);
+            const auto late_count = late_reader.read(events.data(), events.size());
+            check(
+                "a reader starts with the events published after its creation",
+                late_count == 10 && consecutive(events, late_count, t - 10));
+        }
+        {
+            // a child process creates a ring and exits without destroying it, as if it had crashed
+            const auto pid = fork();
+            if (pid == 0) {
+                new ccam_atis_sepia::shared_ring_writer(name, 1 << 10);
+                _exit(0);
+            }
+            auto status = 0;
+            waitpid(pid, &status, 0);
+            auto replaced = true;
+            try {
+                ccam_atis_sepia::shared_ring_writer writer(name, 1 << 10);
+            } catch (const std::runtime_error&) {
+                replaced = false;
+            }
+            check("a ring abandoned by a crashed writer is replaced", replaced);
+        }
+        {
+            ccam_atis_sepia::shared_ring_reader* reader = nullptr;
+            {
+                ccam_atis_sepia::shared_ring_writer writer(name, 1 << 10);
+                reader = new ccam_atis_sepia::shared_ring_reader(name);
+                uint64_t t = 0;
+                write_events(writer, t, 100);
+            }
+            const auto count = reader->read(events.data(), events.size());
+            check(
+                "events published before the writer stopped can still be read",
+                reader->closed() && count == 100 && consecutive(events, count, 0));
+            delete reader;
+        }
+    } catch (const std::exception& exception) {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+    if (failures > 0) {
+        std::cerr << failures << " test" << (failures > 1 ? "s" : "") << " failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
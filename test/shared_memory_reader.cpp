@@ -0,0 +1,44 @@
+#include "../source/ccam_atis_sepia_ring.hpp"
+
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: ccam_atis_sepia_reader <name>\n"
+                     "    name is the shared memory object passed to make_shared_memory_camera (for example /ccam_atis)"
+                  << std::endl;
+        return 1;
+    }
+    try {
+        ccam_atis_sepia::shared_ring_reader reader(argv[1]);
+        std::vector<sepia::atis_event> events(1 << 16);
+        uint64_t read_events = 0;
+        uint64_t latest_t = 0;
+        auto report_time_point = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        for (;;) {
+            // closed is read before the events, so that the last published events are not missed
+            const auto closed = reader.closed();
+            const auto count = reader.read(events.data(), events.size());
+            if (count > 0) {
+                read_events += count;
+                latest_t = events[count - 1].t;
+            } else if (closed) {
+                break;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= report_time_point) {
+                std::cout << "read " << read_events << " events (lost " << reader.lost_events() << "), latest t "
+                          << latest_t << " us" << std::endl;
+                read_events = 0;
+                report_time_point = now + std::chrono::seconds(1);
+            }
+        }
+        std::cout << "the writer stopped, " << reader.lost_events() << " events were lost in total" << std::endl;
+    } catch (const std::exception& exception) {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}